@@ -0,0 +1,33 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <stdint.h>
+
+#define CALIBRATION_CHANNELS 3
+
+// Propagation delay of each channel, from the light changing
+// to the interrupt timestamp, in micros() ticks.
+// The receiver output falls when the light comes on and rises
+// when it goes off, so light_on_us applies to the start
+// timestamps and light_off_us to the end timestamps.
+typedef struct
+{
+  int16_t light_on_us[CALIBRATION_CHANNELS];
+  int16_t light_off_us[CALIBRATION_CHANNELS];
+} calibration_t;
+
+void calibration_load();
+void calibration_save();
+void calibration_clear();
+const calibration_t *calibration_get();
+
+// apply the offsets to raw timestamps
+uint32_t calibration_start_us(uint8_t channel, uint32_t ts_us);
+uint32_t calibration_end_us(uint8_t channel, uint32_t ts_us);
+
+// measure the offsets from a number of reference edges
+void calibration_begin();
+void calibration_add_sample(uint8_t channel, bool light_on, uint32_t delay_us);
+bool calibration_finish();
+
+#endif /* CALIBRATION_H */
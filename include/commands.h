@@ -0,0 +1,26 @@
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <stdint.h>
+
+// A command handler is called with the text after the command name.
+// It may queue at most one line of output (COMMAND_LINE_MAX bytes) per call.
+// Return true to be called again with step+1 on a later pass through
+// loop() once there is room in the transmit queue, or false when done.
+typedef bool (*command_handler_t)(const char *args, uint8_t step);
+
+// The table of commands and the names in it are kept in PROGMEM
+typedef struct
+{
+  const char *name;
+  command_handler_t handler;
+} command_t;
+
+// longest single line a handler may queue, including the line ending
+#define COMMAND_LINE_MAX 88
+
+void commands_setup(const command_t *table, uint8_t count);
+void commands_poll();
+void commands_printf_P(const char *format_P, ...);
+
+#endif /* COMMANDS_H */
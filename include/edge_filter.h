@@ -0,0 +1,56 @@
+#ifndef EDGE_FILTER_H
+#define EDGE_FILTER_H
+
+#include <stdint.h>
+
+// Dust, laser speckle and curtain bounce make very short pulses on the
+// receiver outputs. An edge is only accepted once the level it sets has
+// lasted for the minimum pulse width; if the opposite edge arrives
+// sooner, both are thrown away and the channel goes back to how it was.
+// Accepted edges keep the timestamp taken in the interrupt, so the
+// filter adds no error to them, the main loop just waits for the
+// minimum pulse width before using them.
+//
+// Pulse widths are measured between interrupt timestamps, and the
+// three receivers share one pin change interrupt, so the second edge
+// of a glitch can be timestamped late: after the other two handlers
+// and the Timer0 interrupt, up to about 22us. The default width is a
+// 10us glitch plus that.
+#define EDGE_FILTER_DEFAULT_WIDTH_US 32
+
+// Curtain bounce can open a sensor again for longer than any glitch.
+// For the curtain travel times each channel keeps the first whole
+// exposure until the curtains have been taken, and a later one only
+// replaces it once this long has passed since it ended, which is
+// longer than any curtain takes to cross the sensors.
+#define EDGE_FILTER_DEFAULT_HOLD_US 50000UL
+
+// Everything the detector interrupts record for one channel
+typedef struct
+{
+  uint32_t start_us;     // when the light came on
+  uint32_t end_us;       // when the light went off
+  bool speed_measured;   // set when the light goes off, cleared when it comes on
+  bool curtain_measured; // set with curtain_start/end_us, cleared by the curtain calculation
+  uint32_t curtain_start_us;
+  uint32_t curtain_end_us;
+  uint16_t rejected;     // number of edges thrown away
+
+  // the most recent edge and what it changed, so it can be undone
+  bool light;
+  bool pending;
+  uint32_t edge_us;
+  uint32_t undo_start_us;
+  uint32_t undo_end_us;
+  bool undo_speed_measured;
+  bool undo_curtain_measured;
+} edge_channel_t;
+
+void edge_filter_set_width(uint8_t width_us);
+uint8_t edge_filter_width();
+void edge_filter_set_hold(uint32_t hold_us);
+void edge_filter_reset(volatile edge_channel_t *channel, bool light);
+void edge_filter_edge(volatile edge_channel_t *channel, bool light, uint32_t now_us);
+bool edge_filter_settled(volatile edge_channel_t *channel, uint32_t now_us);
+
+#endif /* EDGE_FILTER_H */
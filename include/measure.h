@@ -0,0 +1,18 @@
+#ifndef MEASURE_H
+#define MEASURE_H
+
+#include <stdint.h>
+
+#include "edge_filter.h"
+
+// Taking finished measurements from the detector channels. The tester
+// and the benchmark both use these, so the benchmark measures the code
+// that runs on the tester. Call them with interrupts off; they only
+// copy, clear a flag and apply the calibration offsets.
+bool measure_take_speed(volatile edge_channel_t *channels, uint8_t detector, uint32_t now_us,
+                        uint32_t *start_us, uint32_t *end_us);
+bool measure_take_curtains(volatile edge_channel_t *channels, uint32_t now_us,
+                           uint32_t *curtain_1_us, uint32_t *curtain_2_us);
+uint32_t measure_travel_us(uint32_t first_us, uint32_t last_us);
+
+#endif /* MEASURE_H */
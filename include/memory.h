@@ -0,0 +1,15 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <stdint.h>
+
+// At reset, before any constructors run, all the RAM between the end of
+// the static variables and the top of the stack is painted with a fixed
+// pattern. The deepest the stack has ever reached is then the lowest
+// byte that no longer holds the pattern.
+uint16_t memory_static_bytes();
+uint16_t memory_heap_bytes();
+uint16_t memory_stack_peak_bytes();
+uint16_t memory_min_free_bytes();
+
+#endif /* MEMORY_H */
@@ -1,6 +1,8 @@
 #ifndef OLED_H
 #define OLED_H
 
+#include <stdint.h>
+
 void oled_setup();
 void oled_show_values( double shutter_speed_1_ms, 
                        double shutter_speed_2_ms,
@@ -10,4 +12,5 @@ void oled_show_values( double shutter_speed_1_ms,
                        double fractional_shutter_speed_3,
                        double curtain_1_travel_time_ms,
                        double curtain_2_travel_time_ms );
+void oled_show_elapsed(uint32_t seconds, uint32_t fraction_us, bool open);
 #endif /* OLED_H */
\ No newline at end of file
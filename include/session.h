@@ -0,0 +1,40 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <stdint.h>
+
+// A session collects the shots taken while the operator works through
+// the shutter speed dial. Each shot is put in the group for the nearest
+// standard speed, from 1s to 1/8000s, and a group is closed as soon as
+// a shot lands in a different one.
+//
+// Guessing the setting from the shot can never show an error of more
+// than half a stop, a shutter that is a whole stop out lands in the
+// group for the next setting and looks perfect. When the rig or the
+// operator declares the setting on the dial, every shot goes into its
+// group whatever it measures, until the declaration is withdrawn.
+#define SESSION_SETTINGS 14
+
+// summary of one group of shots
+typedef struct
+{
+  uint16_t denominator; // nominal speed is 1/denominator seconds
+  uint8_t count;
+  uint32_t mean_us;
+  double ev_error;      // stops, positive means over exposed
+  uint32_t spread_us;   // slowest minus fastest shot
+  uint32_t curtain_1_us;
+  uint32_t curtain_2_us;
+} session_row_t;
+
+void session_begin();
+bool session_declare(uint16_t denominator);
+uint16_t session_declared();
+int8_t session_add_speed(uint32_t shutter_us);
+void session_add_curtains(uint32_t curtain_1_us, uint32_t curtain_2_us);
+int8_t session_end();
+uint8_t session_row_count();
+bool session_row(uint8_t index, session_row_t *row);
+bool session_setting_row(uint8_t setting, session_row_t *row);
+
+#endif /* SESSION_H */
@@ -0,0 +1,42 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+// number of sensors / channels
+#define STATS_CHANNELS 3
+
+// number of recent measurements kept in the log
+#define STATS_LOG_SIZE 16
+
+// log entry kinds
+#define STATS_LOG_SPEED_1 1
+#define STATS_LOG_SPEED_2 2
+#define STATS_LOG_SPEED_3 3
+#define STATS_LOG_CURTAIN 4
+
+typedef struct
+{
+  uint16_t count;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint32_t sum_us; // wraps after ~71 minutes of accumulated exposure
+} stats_accumulator_t;
+
+typedef struct
+{
+  uint8_t kind;
+  uint32_t a_us; // shutter time, or curtain 1 travel time
+  uint32_t b_us; // start timestamp, or curtain 2 travel time
+} stats_log_entry_t;
+
+// channels are numbered from 0 (sensor 1) and curtains from 0 (curtain 1)
+void stats_reset();
+void stats_add_speed(uint8_t channel, uint32_t start_us, uint32_t shutter_us);
+void stats_add_curtains(uint32_t curtain_1_us, uint32_t curtain_2_us);
+const stats_accumulator_t *stats_speed(uint8_t channel);
+const stats_accumulator_t *stats_curtain(uint8_t curtain);
+uint8_t stats_log_count();
+const stats_log_entry_t *stats_log_entry(uint8_t index);
+
+#endif /* STATS_H */
@@ -1,6 +1,8 @@
 #ifndef TFT_H
 #define TFT_H
 
+#include "session.h"
+
 void tft_setup();
 void tft_show_values( double shutter_speed_1_ms, 
                       double shutter_speed_2_ms,
@@ -10,6 +12,9 @@ void tft_show_values( double shutter_speed_1_ms,
                       double fractional_shutter_speed_3,
                       double curtain_1_travel_time_ms,
                       double curtain_2_travel_time_ms );
+void tft_show_session_header();
+void tft_show_session_row(uint8_t line, const session_row_t *row);
+void tft_show_elapsed(uint32_t seconds, uint32_t fraction_us, bool open);
 void tft_colour_demo();
 
 #endif /* TFT_H */
\ No newline at end of file
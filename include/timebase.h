@@ -0,0 +1,16 @@
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <stdint.h>
+
+// micros() wraps round every 2^32 us, about 71 minutes. The timebase
+// counts the wraps to give 64 bit times that never wrap.
+// timebase_update() must be called at least once per wrap, and
+// timestamps are extended relative to the time last passed to it, so
+// they must be within half a wrap (about 35 minutes) of it, before or
+// after. A calibrated timestamp can be a few microseconds after it.
+void timebase_update(uint32_t now_us);
+uint64_t timebase_now_us();
+uint64_t timebase_extend(uint32_t ts_us);
+
+#endif /* TIMEBASE_H */
@@ -0,0 +1,176 @@
+# PlatformIO extra script: flash/RAM size report and budget check.
+#
+# After every link the flash and static RAM used are checked against the
+# budgets set in platformio.ini and the build fails if either is over:
+#
+#   custom_flash_budget  bytes of flash (.text + .data), the board's
+#                        upload.maximum_size if not set
+#   custom_ram_budget    bytes of RAM (.data + .bss + custom_ram_heap)
+#   custom_ram_heap      RAM allocated at run time that the linker does
+#                        not see, e.g. the SSD1306 frame buffer
+#
+# "pio run -t size_report" also writes a per module and per symbol
+# breakdown to .pio/build/<env>/size_report.txt.
+#
+# Stack use can only be seen at run time, see the "mem" serial command.
+#
+# The parsing and the budget check do not need PlatformIO, they are
+# tested on the PC by test_size_report.py.
+
+import os
+import re
+import subprocess
+from collections import defaultdict
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+except NameError:
+    env = None  # imported by the tests
+
+
+def parse_section_sizes(output):
+    """Sizes of the sections that take flash and RAM, from avr-size -A"""
+    sizes = defaultdict(int)
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[0] in (".text", ".data", ".bss", ".noinit"):
+            sizes[fields[0]] = int(fields[1])
+    return sizes
+
+
+def budget_check(name, sizes, heap, flash_budget, ram_budget):
+    """Returns the lines to print and whether the build is over budget"""
+    flash = sizes[".text"] + sizes[".data"]
+    ram = sizes[".data"] + sizes[".bss"] + sizes[".noinit"] + heap
+    lines = [
+        "Flash: %5d of %5d bytes budget" % (flash, flash_budget),
+        "RAM:   %5d of %5d bytes budget (%d allocated at run time)" % (ram, ram_budget, heap),
+    ]
+    over = flash > flash_budget or ram > ram_budget
+    if over:
+        lines.append("*** Over the memory budget for %s ***" % name)
+    return lines, over
+
+
+def parse_map(map_file):
+    """Sum the input sections in a linker map file by object file"""
+    # input sections are indented, output sections start in column 0
+    section_re = re.compile(r"^\s+\.(text|data|bss|progmem)\S*\s+0x[0-9a-f]+\s+0x([0-9a-f]+)\s+(\S+)")
+    wrapped_re = re.compile(r"^\s+\.(text|data|bss|progmem)\S*$")
+    continued_re = re.compile(r"^\s+0x[0-9a-f]+\s+0x([0-9a-f]+)\s+(\S+)")
+    modules = defaultdict(lambda: defaultdict(int))
+    pending = None
+    # the sections removed by --gc-sections are listed before the map
+    for line in map_file:
+        if line.startswith("Linker script and memory map"):
+            break
+    for line in map_file:
+        match = section_re.match(line)
+        if match:
+            section, size, path = match.groups()
+        elif pending and continued_re.match(line):
+            section = pending
+            size, path = continued_re.match(line).groups()
+        else:
+            match = wrapped_re.match(line)
+            pending = match.group(1) if match else None
+            continue
+        pending = None
+        modules[module_name(path)][section] += int(size, 16)
+    return modules
+
+
+def module_name(path):
+    # .pio/build/env/src/main.cpp.o -> main.cpp
+    # .../libFrameworkArduino.a(HardwareSerial.cpp.o) -> libFrameworkArduino.a(HardwareSerial.cpp)
+    path = path.replace(".o)", ")")
+    if path.endswith(".o"):
+        path = path[:-2]
+    return os.path.basename(path)
+
+
+def parse_symbols(output):
+    """(size, type, name) from avr-nm --print-size"""
+    symbols = []
+    for line in output.splitlines():
+        fields = line.split(None, 3)
+        if len(fields) == 4:
+            symbols.append((int(fields[1], 16), fields[2], fields[3]))
+    return symbols
+
+
+def report_lines(name, sizes, modules, symbols):
+    lines = ["Size report for %s" % name, ""]
+    lines.append("text=%d data=%d bss=%d" % (sizes[".text"], sizes[".data"], sizes[".bss"]))
+    lines.append("")
+
+    lines.append("%-48s %7s %7s %7s %7s" % ("module", "flash", "ram", "text", "progmem"))
+
+    def flash(m):
+        return m["text"] + m["data"] + m["progmem"]
+
+    for module, m in sorted(modules.items(), key=lambda item: -flash(item[1])):
+        lines.append(
+            "%-48s %7d %7d %7d %7d" % (module[:48], flash(m), m["data"] + m["bss"], m["text"], m["progmem"])
+        )
+    lines.append("")
+
+    # nm types: t/T code, d/D initialised data (flash and RAM), b/B RAM only
+    lines.append("%-7s %4s %s" % ("size", "type", "symbol"))
+    for size, kind, symbol in symbols:
+        lines.append("%7d %4s %s" % (size, kind, symbol))
+    return lines
+
+
+# Only when run by PlatformIO
+if env is not None:
+    MAP_FILE = os.path.join(env.subst("$BUILD_DIR"), "firmware.map")
+    REPORT_FILE = os.path.join(env.subst("$BUILD_DIR"), "size_report.txt")
+    ELF_FILE = os.path.join(env.subst("$BUILD_DIR"), env.subst("${PROGNAME}.elf"))
+
+    env.Append(LINKFLAGS=["-Wl,-Map," + MAP_FILE])
+
+    def option(name, default):
+        return int(env.GetProjectOption(name, default))
+
+    def tool(name):
+        # avr-gcc -> avr-size, avr-nm
+        return env.subst("$CC").replace("gcc", name)
+
+    def section_sizes():
+        return parse_section_sizes(subprocess.check_output([tool("size"), "-A", ELF_FILE], text=True))
+
+    def check_budget(target, source, env):
+        lines, over = budget_check(
+            env.subst("$PIOENV"),
+            section_sizes(),
+            option("custom_ram_heap", 0),
+            option("custom_flash_budget", env.BoardConfig().get("upload.maximum_size")),
+            option("custom_ram_budget", 2048),
+        )
+        print("\n".join(lines))
+        return 1 if over else 0
+
+    def size_report(target, source, env):
+        with open(MAP_FILE) as map_file:
+            modules = parse_map(map_file)
+        symbols = parse_symbols(
+            subprocess.check_output(
+                [tool("nm"), "--size-sort", "--print-size", "--reverse-sort", "-C", ELF_FILE], text=True
+            )
+        )
+        lines = report_lines(env.subst("$PIOENV"), section_sizes(), modules, symbols)
+        with open(REPORT_FILE, "w") as report:
+            report.write("\n".join(lines) + "\n")
+        print("\n".join(lines[:40]))
+        print("...\nFull report in " + REPORT_FILE)
+        return check_budget(target, source, env)
+
+    env.AddPostAction(ELF_FILE, check_budget)
+    env.AddCustomTarget(
+        name="size_report",
+        dependencies=ELF_FILE,
+        actions=[size_report],
+        title="Size Report",
+        description="Flash and RAM used by each module and symbol, checked against the budgets",
+    )
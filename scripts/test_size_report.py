@@ -0,0 +1,207 @@
+"""Tests for the size report parsing and budget check in size_report.py,
+against avr-size, avr-nm and linker map output in the form avr-gcc 7.3
+writes it.
+
+Run from the scripts directory with:
+
+    python -m unittest test_size_report
+"""
+
+import io
+import os
+import subprocess
+import unittest
+from unittest import mock
+
+from size_report import budget_check, parse_map, parse_section_sizes, parse_symbols, report_lines
+
+AVR_SIZE = """\
+.pio/build/nanoatmega328new/firmware.elf  :
+section                    size      addr
+.data                       402   8388864
+.text                     27154         0
+.bss                       1108   8389266
+.comment                     17         0
+.note.gnu.avr.deviceinfo     64         0
+.debug_info                5620         0
+Total                     34365
+"""
+
+MAP = """\
+Archive member included to satisfy reference by file (symbol)
+
+.pio/build/nanoatmega328new/libFrameworkArduino.a(main.cpp.o)
+                              /usr/lib/avr5/crtatmega328p.o (main)
+
+Discarded input sections
+
+ .text          0x00000000        0x0 .pio/build/nanoatmega328new/src/stats.cpp.o
+ .bss._ZL11log_entries
+                0x00000000       0x90 .pio/build/nanoatmega328new/src/stats.cpp.o
+
+Memory Configuration
+
+Name             Origin             Length             Attributes
+text             0x00000000         0x00020000         xr
+
+Linker script and memory map
+
+.text           0x00000000     0x6a12
+ *(.vectors)
+ .vectors       0x00000000       0x68 /usr/lib/avr5/crtatmega328p.o
+                0x00000000                __vectors
+ .progmem.data  0x00000068      0x4fb .pio/build/nanoatmega328new/src/tft.cpp.o
+ .text._Z5setupv
+                0x00000563      0x1c4 .pio/build/nanoatmega328new/src/main.cpp.o
+                0x00000563                setup()
+ .text._Z4loopv
+                0x00000727      0x6b0 .pio/build/nanoatmega328new/src/main.cpp.o
+ .text          0x00000dd7       0x9c .pio/build/nanoatmega328new/libFrameworkArduino.a(HardwareSerial.cpp.o)
+
+.data           0x00800100      0x192 load address 0x00006a12
+ .data          0x00800100       0x2e .pio/build/nanoatmega328new/src/main.cpp.o
+
+.bss            0x00800292      0x454
+ .bss.detectors
+                0x00800292       0x6c .pio/build/nanoatmega328new/src/main.cpp.o
+                0x00800292                detectors
+ .bss._ZL6groups
+                0x008002fe      0x134 .pio/build/nanoatmega328new/src/session.cpp.o
+ .bss           0x00800432       0x9d .pio/build/nanoatmega328new/libFrameworkArduino.a(HardwareSerial0.cpp.o)
+"""
+
+NM = """\
+00800432 0000009d B Serial
+008002fe 00000134 b groups
+000003e4 0000004c T loop()
+"""
+
+
+class SectionSizeTest(unittest.TestCase):
+    def test_flash_and_ram_sections(self):
+        sizes = parse_section_sizes(AVR_SIZE)
+        self.assertEqual((sizes[".text"], sizes[".data"], sizes[".bss"]), (27154, 402, 1108))
+
+    def test_missing_section_is_zero(self):
+        self.assertEqual(parse_section_sizes(AVR_SIZE)[".noinit"], 0)
+
+
+class BudgetTest(unittest.TestCase):
+    sizes = parse_section_sizes(AVR_SIZE)
+
+    def test_within_budget(self):
+        lines, over = budget_check("tft", self.sizes, 0, 32256, 1792)
+        self.assertFalse(over)
+        self.assertEqual(lines[0], "Flash: 27556 of 32256 bytes budget")
+        self.assertEqual(lines[1], "RAM:    1510 of  1792 bytes budget (0 allocated at run time)")
+
+    def test_exactly_on_budget_passes(self):
+        self.assertFalse(budget_check("tft", self.sizes, 0, 27556, 1510)[1])
+
+    def test_flash_over_budget_fails(self):
+        lines, over = budget_check("tft", self.sizes, 0, 27555, 1792)
+        self.assertTrue(over)
+        self.assertEqual(lines[-1], "*** Over the memory budget for tft ***")
+
+    def test_heap_counts_against_ram(self):
+        # 1510 static bytes and the 1024 byte OLED frame buffer
+        lines, over = budget_check("oled", self.sizes, 1024, 32256, 1792)
+        self.assertTrue(over)
+        self.assertEqual(lines[1], "RAM:    2534 of  1792 bytes budget (1024 allocated at run time)")
+
+
+class MapTest(unittest.TestCase):
+    def setUp(self):
+        self.modules = parse_map(io.StringIO(MAP))
+
+    def test_sections_summed_by_module(self):
+        self.assertEqual(self.modules["main.cpp"]["text"], 0x1C4 + 0x6B0)
+        self.assertEqual(self.modules["main.cpp"]["data"], 0x2E)
+
+    def test_wrapped_section_names(self):
+        self.assertEqual(self.modules["main.cpp"]["bss"], 0x6C)
+        self.assertEqual(self.modules["session.cpp"]["bss"], 0x134)
+
+    def test_progmem(self):
+        self.assertEqual(self.modules["tft.cpp"]["progmem"], 0x4FB)
+
+    def test_archive_members(self):
+        self.assertEqual(self.modules["libFrameworkArduino.a(HardwareSerial0.cpp)"]["bss"], 0x9D)
+
+    def test_discarded_sections_are_not_counted(self):
+        self.assertNotIn("stats.cpp", self.modules)
+
+    def test_output_sections_and_symbols_are_not_counted(self):
+        self.assertEqual(sum(m["text"] for m in self.modules.values()), 0x1C4 + 0x6B0 + 0x9C)
+
+
+class ReportTest(unittest.TestCase):
+    def test_report(self):
+        lines = report_lines("tft", parse_section_sizes(AVR_SIZE), parse_map(io.StringIO(MAP)),
+                             parse_symbols(NM))
+        self.assertEqual(lines[2], "text=27154 data=402 bss=1108")
+        # biggest flash user first
+        self.assertTrue(lines[5].startswith("main.cpp"))
+        self.assertIn("    157    B Serial", lines)
+
+
+class FakeEnv:
+    """Just enough of the PlatformIO SCons environment to load the script"""
+
+    def __init__(self, options):
+        self.options = options
+        self.post_actions = []
+
+    def subst(self, text):
+        return {"$BUILD_DIR": "build", "${PROGNAME}.elf": "firmware.elf", "$PIOENV": "oled",
+                "$CC": "avr-gcc"}[text]
+
+    def Append(self, **kwargs):
+        pass
+
+    def GetProjectOption(self, name, default):
+        return self.options.get(name, default)
+
+    def BoardConfig(self):
+        return {"upload.maximum_size": 32256}
+
+    def AddPostAction(self, target, action):
+        self.post_actions.append(action)
+
+    def AddCustomTarget(self, **kwargs):
+        pass
+
+
+def load_script(options):
+    """Run size_report.py the way PlatformIO does, returns its post action"""
+    env = FakeEnv(options)
+    namespace = {"__name__": "size_report"}
+    namespace["Import"] = lambda name: namespace.update(env=env)
+    path = os.path.join(os.path.dirname(os.path.abspath(__file__)), "size_report.py")
+    with open(path) as script:
+        exec(compile(script.read(), path, "exec"), namespace)
+    return env, env.post_actions[0]
+
+
+class PlatformIOTest(unittest.TestCase):
+    def run_check(self, options):
+        env, check = load_script(options)
+        with mock.patch.object(subprocess, "check_output", return_value=AVR_SIZE) as size, \
+                mock.patch("sys.stdout", new_callable=io.StringIO) as output:
+            result = check(None, None, env)
+        size.assert_called_with(["avr-size", "-A", os.path.join("build", "firmware.elf")], text=True)
+        return result, output.getvalue()
+
+    def test_build_within_budget_passes(self):
+        result, output = self.run_check({"custom_ram_budget": "1792"})
+        self.assertEqual(result, 0)
+        self.assertIn("Flash: 27556 of 32256 bytes budget", output)
+
+    def test_build_over_budget_fails(self):
+        result, output = self.run_check({"custom_ram_budget": "1792", "custom_ram_heap": "1024"})
+        self.assertEqual(result, 1)
+        self.assertIn("*** Over the memory budget for oled ***", output)
+
+
+if __name__ == "__main__":
+    unittest.main()
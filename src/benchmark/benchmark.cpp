@@ -0,0 +1,725 @@
+// The host tests link the same sources and bring their own main()
+#ifndef PIO_UNIT_TESTING
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "calibration.h"
+#include "edge_filter.h"
+#include "measure.h"
+#include "version.h"
+
+// Accuracy and latency benchmark of the capture engines.
+//
+// Built for the host by the "native" environment. Every engine is given
+// the same synthetic shots, 1s to 1/8000s with horizontal and vertical
+// curtains, clean, with curtain bounce and with noise, and the edges it
+// would capture are run through the real edge filter and calibration
+// code and the measure module that the main loop uses.
+//
+// The output is one JSON object per line:
+//   "run"       firmware version and benchmark settings
+//   "display"   host time to format one display update
+//   "accuracy"  error distributions and cost for one engine and scenario
+//   "summary"   the same over all the scenarios of an engine
+//
+// The engines and sensors are models, their numbers are estimates
+// from the ATmega328P datasheet and can be tuned below. The CPU cost
+// on the device is the modelled interrupt time, the host time is only
+// useful for comparing firmware versions.
+
+#define SHOTS_PER_SCENARIO 200
+#define DEFAULT_SEED 20261019ULL
+#define SENSORS 3
+
+// main loop pass time while nothing is being displayed
+#define LOOP_POLL_NS 150000.0
+
+// time before the first curtain moves and after the last one stops
+#define SHOT_LEAD_NS 1000000.0
+#define SHOT_TAIL_NS 2000000.0
+#define MIN_SLIT_NS 20000.0
+
+// same as the calibrate mode in main.cpp
+#define CALIBRATION_PULSES 16
+#define CALIBRATION_HALF_PERIOD_NS 20000000.0
+
+//---------------------------------------------------
+// Capture engines
+//---------------------------------------------------
+typedef struct
+{
+  const char *name;
+  double unit_ns;       // one count of the timestamp
+  double resolution_ns; // timestamps are multiples of this
+  double latency_ns;    // from the edge to the timestamp
+  double jitter_ns;     // longest extra latency from another interrupt running
+  double jitter_chance; // how often that happens
+  double read_ns;       // from the timestamp to reading the pin
+  double service_ns;    // time the interrupt takes per edge
+  bool shared_vector;   // one interrupt serves all the sensors
+  bool latched;         // the timer hardware captures the edge
+  uint8_t channels;     // sensors the engine can capture, bit 0 is S1
+} engine_t;
+
+// The Timer0 overflow interrupt behind micros() runs every 1024us for
+// about 5us, so roughly one edge in a hundred waits for it
+static const engine_t engines[] = {
+    // the current firmware: PinChangeInterrupt, micros() then digitalRead()
+    {"pcint_micros", 1000.0, 4000.0, 2500.0, 5000.0, 0.01, 3500.0, 9000.0, true, false, 0x7},
+    // INT0, INT1 and a pin change vector of its own, reading PIND
+    // and a free running Timer1 at 2MHz
+    {"port_isr_timer1", 500.0, 500.0, 1500.0, 5000.0, 0.01, 200.0, 3000.0, false, false, 0x7},
+    // Timer1 input capture with the noise canceller (4 clocks), there
+    // is only one ICP1 pin so only the centre sensor can use it
+    {"timer1_icp", 62.5, 62.5, 250.0, 0.0, 0.0, 0.0, 2000.0, false, true, 0x2},
+};
+#define ENGINES (sizeof(engines) / sizeof(engines[0]))
+
+//---------------------------------------------------
+// Sensors, receiver delays differ between channels
+//---------------------------------------------------
+static const double sensor_on_delay_ns[SENSORS] = {42000.0, 55000.0, 47000.0};
+static const double sensor_off_delay_ns[SENSORS] = {12000.0, 20000.0, 9000.0};
+#define SENSOR_JITTER_NS 800.0
+
+//---------------------------------------------------
+// Scenarios
+//---------------------------------------------------
+static const uint16_t denominators[] = {1, 2, 4, 8, 15, 30, 60, 125, 250, 500, 1000, 2000, 4000, 8000};
+#define SPEEDS (sizeof(denominators) / sizeof(denominators[0]))
+
+typedef struct
+{
+  const char *name;
+  double curtain_1_ns; // time to travel from the first sensor to the last
+  double curtain_2_ns;
+  bool reversed;       // curtains reach S3 first
+} travel_t;
+
+static const travel_t travels[] = {
+    {"horizontal", 8000000.0, 8300000.0, false}, // cloth, across the long side
+    {"vertical", 2400000.0, 2500000.0, true},    // metal blades, across the short side
+};
+#define TRAVELS (sizeof(travels) / sizeof(travels[0]))
+
+typedef enum
+{
+  DISTURBANCE_CLEAN,
+  DISTURBANCE_BOUNCE,
+  DISTURBANCE_NOISE,
+  DISTURBANCES
+} disturbance_t;
+
+static const char *disturbance_names[DISTURBANCES] = {"clean", "bounce", "noise"};
+
+#define NOISE_GLITCHES_PER_SENSOR 6
+#define NOISE_MAX_WIDTH_NS 6000.0
+
+//---------------------------------------------------
+// Random numbers. The shots and the engines draw
+// from separate generators so every engine is
+// given exactly the same shots.
+//---------------------------------------------------
+static uint64_t shot_rng = DEFAULT_SEED;
+static uint64_t engine_rng = DEFAULT_SEED;
+
+static uint64_t rng_next(uint64_t *state)
+{
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+static double rng_uniform(uint64_t *state)
+{
+  return (rng_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double rng_gauss(uint64_t *state)
+{
+  double u = rng_uniform(state);
+  double v = rng_uniform(state);
+  return sqrt(-2.0 * log(u + 1e-300)) * cos(2.0 * M_PI * v);
+}
+
+//---------------------------------------------------
+// A receiver output as the times its level changes
+//---------------------------------------------------
+typedef struct
+{
+  bool initial_light;
+  std::vector<double> toggles_ns;
+} waveform_t;
+
+static bool waveform_light(const waveform_t *waveform, double t_ns)
+{
+  size_t count = std::upper_bound(waveform->toggles_ns.begin(), waveform->toggles_ns.end(), t_ns) -
+                 waveform->toggles_ns.begin();
+  return waveform->initial_light != (count % 2 == 1);
+}
+
+//---------------------------------------------------
+// Light reaching a sensor between two times,
+// as seen through the receiver's delays
+//---------------------------------------------------
+static void add_light(waveform_t *waveform, uint8_t sensor, double on_ns, double off_ns)
+{
+  double out_on_ns = on_ns + sensor_on_delay_ns[sensor] + SENSOR_JITTER_NS * rng_gauss(&shot_rng);
+  double out_off_ns = off_ns + sensor_off_delay_ns[sensor] + SENSOR_JITTER_NS * rng_gauss(&shot_rng);
+  if (out_off_ns > out_on_ns)
+  {
+    waveform->toggles_ns.push_back(out_on_ns);
+    waveform->toggles_ns.push_back(out_off_ns);
+  }
+}
+
+//---------------------------------------------------
+// One synthetic shot and what really happened
+//---------------------------------------------------
+typedef struct
+{
+  waveform_t sensors[SENSORS];
+  double open_ns[SENSORS];
+  double close_ns[SENSORS];
+  double end_ns;
+  uint64_t base_units; // where the timestamp counter was when the shot began
+} shot_t;
+
+static void make_shot(shot_t *shot, double nominal_ns, const travel_t *travel, disturbance_t disturbance)
+{
+  double exposure_ns = nominal_ns * (1.0 + 0.05 * rng_gauss(&shot_rng));
+  double curtain_1_ns = travel->curtain_1_ns * (1.0 + 0.02 * rng_gauss(&shot_rng));
+  // the curtains share a spring tension, so their speeds go together
+  double curtain_2_ns = curtain_1_ns * (travel->curtain_2_ns / travel->curtain_1_ns) * (1.0 + 0.002 * rng_gauss(&shot_rng));
+
+  shot->end_ns = SHOT_LEAD_NS + exposure_ns + std::max(curtain_1_ns, curtain_2_ns) + SHOT_TAIL_NS;
+  shot->base_units = rng_next(&shot_rng) & 0xFFFFFFFFULL;
+
+  for (uint8_t i = 0; i < SENSORS; i++)
+  {
+    double position = i / (double)(SENSORS - 1);
+    if (travel->reversed)
+    {
+      position = 1.0 - position;
+    }
+    waveform_t *waveform = &shot->sensors[i];
+    waveform->initial_light = false;
+    waveform->toggles_ns.clear();
+
+    shot->open_ns[i] = SHOT_LEAD_NS + position * curtain_1_ns;
+    // a slit never quite closes up
+    shot->close_ns[i] = std::max(SHOT_LEAD_NS + exposure_ns + position * curtain_2_ns,
+                                 shot->open_ns[i] + MIN_SLIT_NS);
+    add_light(waveform, i, shot->open_ns[i], shot->close_ns[i]);
+
+    // the trailing curtain bounces open again after it closes
+    if (disturbance == DISTURBANCE_BOUNCE)
+    {
+      double bounce_ns = shot->close_ns[i] + 100000.0 + 300000.0 * rng_uniform(&shot_rng);
+      add_light(waveform, i, bounce_ns, bounce_ns + 15000.0 + 25000.0 * rng_uniform(&shot_rng));
+    }
+
+    // dust and laser speckle, short pulses at any time
+    if (disturbance == DISTURBANCE_NOISE)
+    {
+      for (uint8_t g = 0; g < NOISE_GLITCHES_PER_SENSOR; g++)
+      {
+        double glitch_ns = shot->end_ns * rng_uniform(&shot_rng);
+        waveform->toggles_ns.push_back(glitch_ns);
+        waveform->toggles_ns.push_back(glitch_ns + 300.0 + (NOISE_MAX_WIDTH_NS - 300.0) * rng_uniform(&shot_rng));
+      }
+    }
+    std::sort(waveform->toggles_ns.begin(), waveform->toggles_ns.end());
+  }
+}
+
+//---------------------------------------------------
+// Interrupt calls an engine makes for a shot
+//---------------------------------------------------
+typedef struct
+{
+  double call_ns;
+  uint8_t sensor;
+  bool light;
+  uint32_t ts;
+} isr_call_t;
+
+static bool call_earlier(const isr_call_t &a, const isr_call_t &b)
+{
+  return a.call_ns < b.call_ns;
+}
+
+static uint32_t timestamp(const engine_t *engine, uint64_t base_units, double t_ns)
+{
+  uint64_t ticks = (uint64_t)floor(t_ns / engine->resolution_ns);
+  return (uint32_t)(base_units + ticks * (uint64_t)(engine->resolution_ns / engine->unit_ns));
+}
+
+typedef struct
+{
+  double t_ns;
+  uint8_t sensor;
+} toggle_t;
+
+static bool toggle_earlier(const toggle_t &a, const toggle_t &b)
+{
+  return a.t_ns < b.t_ns;
+}
+
+static void capture(const engine_t *engine, const waveform_t *sensors, uint64_t base_units,
+                    std::vector<isr_call_t> *calls)
+{
+  std::vector<toggle_t> toggles;
+  for (uint8_t i = 0; i < SENSORS; i++)
+  {
+    if (engine->channels & (1 << i))
+    {
+      for (size_t t = 0; t < sensors[i].toggles_ns.size(); t++)
+      {
+        toggle_t toggle = {sensors[i].toggles_ns[t], i};
+        toggles.push_back(toggle);
+      }
+    }
+  }
+  std::sort(toggles.begin(), toggles.end(), toggle_earlier);
+
+  double busy_until_ns[SENSORS] = {-1e18, -1e18, -1e18};
+  double entered_ns[SENSORS] = {-1e18, -1e18, -1e18};
+  bool expect_light[SENSORS];
+  for (uint8_t i = 0; i < SENSORS; i++)
+  {
+    expect_light[i] = !sensors[i].initial_light;
+  }
+
+  calls->clear();
+  for (size_t t = 0; t < toggles.size(); t++)
+  {
+    uint8_t s = toggles[t].sensor;
+    double t_ns = toggles[t].t_ns;
+    isr_call_t call;
+    call.sensor = s;
+
+    if (engine->latched)
+    {
+      // the capture unit waits for the selected edge, the interrupt
+      // then selects the other one and reads the pin in case it
+      // changed back in the meantime
+      bool light = waveform_light(&sensors[s], t_ns);
+      if (light != expect_light[s] || t_ns < busy_until_ns[s])
+      {
+        continue;
+      }
+      double done_ns = t_ns + engine->service_ns;
+      bool light_now = waveform_light(&sensors[s], done_ns);
+      busy_until_ns[s] = done_ns;
+      expect_light[s] = !light_now;
+      call.call_ns = done_ns;
+      call.light = light;
+      call.ts = timestamp(engine, base_units, t_ns + engine->latency_ns);
+      calls->push_back(call);
+      if (light_now != light)
+      {
+        call.light = light_now;
+        call.ts = timestamp(engine, base_units, done_ns);
+        calls->push_back(call);
+      }
+      continue;
+    }
+
+    // a change before the interrupt is entered only sets the flag again
+    if (entered_ns[s] >= t_ns)
+    {
+      continue;
+    }
+    uint8_t vector = engine->shared_vector ? 0 : s;
+    double start_ns = t_ns + engine->latency_ns;
+    if (rng_uniform(&engine_rng) < engine->jitter_chance)
+    {
+      start_ns += engine->jitter_ns * rng_uniform(&engine_rng);
+    }
+    start_ns = std::max(start_ns, busy_until_ns[vector]);
+    busy_until_ns[vector] = start_ns + engine->service_ns;
+    entered_ns[s] = start_ns;
+    call.call_ns = start_ns;
+    call.light = waveform_light(&sensors[s], start_ns + engine->read_ns);
+    call.ts = timestamp(engine, base_units, start_ns);
+    calls->push_back(call);
+  }
+  std::sort(calls->begin(), calls->end(), call_earlier);
+}
+
+//---------------------------------------------------
+// The measurement side, the same code as main.cpp
+//---------------------------------------------------
+static edge_channel_t channels[SENSORS];
+
+typedef struct
+{
+  bool speed_taken;
+  bool curtains_taken;
+  uint16_t spurious; // measurements after the first one
+  double shutter_ns;
+  double curtain_1_ns;
+  double curtain_2_ns;
+  double host_ns;
+} shot_result_t;
+
+typedef std::chrono::steady_clock host_clock;
+
+static double host_elapsed_ns(host_clock::time_point since)
+{
+  return std::chrono::duration<double, std::nano>(host_clock::now() - since).count();
+}
+
+//---------------------------------------------------
+// Run the captured edges through the filter and the
+// main loop's polling. Only the interrupt calls and
+// the polls that take a measurement are timed.
+//---------------------------------------------------
+static void process_shot(const engine_t *engine, const shot_t *shot, const std::vector<isr_call_t> &calls,
+                         shot_result_t *result)
+{
+  memset(result, 0, sizeof(*result));
+  for (uint8_t i = 0; i < SENSORS; i++)
+  {
+    edge_filter_reset(&channels[i], shot->sensors[i].initial_light);
+  }
+
+  size_t next = 0;
+  for (double poll_ns = 0.0; poll_ns <= shot->end_ns; poll_ns += LOOP_POLL_NS)
+  {
+    while (next < calls.size() && calls[next].call_ns <= poll_ns)
+    {
+      host_clock::time_point begin = host_clock::now();
+      edge_filter_edge(&channels[calls[next].sensor], calls[next].light, calls[next].ts);
+      result->host_ns += host_elapsed_ns(begin);
+      next++;
+    }
+
+    uint32_t now = timestamp(engine, shot->base_units, poll_ns);
+    uint32_t start;
+    uint32_t end;
+    uint32_t curtain_1;
+    uint32_t curtain_2;
+
+    host_clock::time_point begin = host_clock::now();
+    if (measure_take_speed(channels, 1, now, &start, &end))
+    {
+      result->host_ns += host_elapsed_ns(begin);
+      if (result->speed_taken)
+      {
+        result->spurious++;
+      }
+      else
+      {
+        result->speed_taken = true;
+        result->shutter_ns = (uint32_t)(end - start) * engine->unit_ns;
+      }
+    }
+    begin = host_clock::now();
+    if (measure_take_curtains(channels, now, &curtain_1, &curtain_2))
+    {
+      result->host_ns += host_elapsed_ns(begin);
+      if (result->curtains_taken)
+      {
+        result->spurious++;
+      }
+      else
+      {
+        result->curtains_taken = true;
+        result->curtain_1_ns = curtain_1 * engine->unit_ns;
+        result->curtain_2_ns = curtain_2 * engine->unit_ns;
+      }
+    }
+  }
+}
+
+//---------------------------------------------------
+// Calibrate an engine the way the calibrate mode
+// does, switching each laser off and on in turn
+//---------------------------------------------------
+static void calibrate_engine(const engine_t *engine)
+{
+  waveform_t sensors[SENSORS];
+  uint16_t edges = CALIBRATION_PULSES * 2 * SENSORS;
+  uint64_t base_units = rng_next(&engine_rng) & 0xFFFFFFFFULL;
+  double end_ns = (edges + 1) * CALIBRATION_HALF_PERIOD_NS;
+
+  for (uint8_t i = 0; i < SENSORS; i++)
+  {
+    sensors[i].initial_light = true;
+    sensors[i].toggles_ns.clear();
+  }
+  for (uint16_t edge = 1; edge <= edges; edge++)
+  {
+    uint8_t i = ((edge - 1) / 2) % SENSORS;
+    double edge_ns = edge * CALIBRATION_HALF_PERIOD_NS;
+    double delay_ns = (edge % 2) ? sensor_off_delay_ns[i] : sensor_on_delay_ns[i];
+    sensors[i].toggles_ns.push_back(edge_ns + delay_ns + SENSOR_JITTER_NS * rng_gauss(&engine_rng));
+  }
+
+  std::vector<isr_call_t> calls;
+  capture(engine, sensors, base_units, &calls);
+  for (uint8_t i = 0; i < SENSORS; i++)
+  {
+    edge_filter_reset(&channels[i], true);
+  }
+
+  calibration_begin();
+  size_t next = 0;
+  for (uint16_t edge = 1; edge <= edges; edge++)
+  {
+    uint8_t i = ((edge - 1) / 2) % SENSORS;
+    double edge_ns = edge * CALIBRATION_HALF_PERIOD_NS;
+    double sample_ns = std::min(edge_ns + CALIBRATION_HALF_PERIOD_NS, end_ns);
+    uint32_t edge_ts = timestamp(engine, base_units, edge_ns);
+    bool light_on = (edge % 2) == 0;
+
+    while (next < calls.size() && calls[next].call_ns <= sample_ns)
+    {
+      edge_filter_edge(&channels[calls[next].sensor], calls[next].light, calls[next].ts);
+      next++;
+    }
+
+    // sensors the engine cannot capture get no correction
+    uint32_t delay = 0;
+    if (engine->channels & (1 << i))
+    {
+      delay = (light_on ? channels[i].start_us : channels[i].end_us) - edge_ts;
+    }
+    calibration_add_sample(i, light_on, delay);
+  }
+  calibration_finish();
+}
+
+//---------------------------------------------------
+// Error distributions
+//---------------------------------------------------
+typedef struct
+{
+  std::vector<double> shutter_us;
+  std::vector<double> ev;
+  std::vector<double> curtain_1_us;
+  std::vector<double> curtain_2_us;
+  uint32_t shots;
+  uint32_t missed;
+  uint32_t spurious;
+  uint32_t isr_calls;
+  double host_ns;
+} errors_t;
+
+static void errors_clear(errors_t *errors)
+{
+  errors->shutter_us.clear();
+  errors->ev.clear();
+  errors->curtain_1_us.clear();
+  errors->curtain_2_us.clear();
+  errors->shots = 0;
+  errors->missed = 0;
+  errors->spurious = 0;
+  errors->isr_calls = 0;
+  errors->host_ns = 0.0;
+}
+
+static void errors_append(errors_t *to, const errors_t *from)
+{
+  to->shutter_us.insert(to->shutter_us.end(), from->shutter_us.begin(), from->shutter_us.end());
+  to->ev.insert(to->ev.end(), from->ev.begin(), from->ev.end());
+  to->curtain_1_us.insert(to->curtain_1_us.end(), from->curtain_1_us.begin(), from->curtain_1_us.end());
+  to->curtain_2_us.insert(to->curtain_2_us.end(), from->curtain_2_us.begin(), from->curtain_2_us.end());
+  to->shots += from->shots;
+  to->missed += from->missed;
+  to->spurious += from->spurious;
+  to->isr_calls += from->isr_calls;
+  to->host_ns += from->host_ns;
+}
+
+//---------------------------------------------------
+// Print a distribution as a JSON object, or null
+// when there is nothing in it
+//---------------------------------------------------
+static void print_distribution(const char *name, std::vector<double> values)
+{
+  if (values.empty())
+  {
+    printf(",\"%s\":null", name);
+    return;
+  }
+
+  double sum = 0.0;
+  for (size_t i = 0; i < values.size(); i++)
+  {
+    sum += values[i];
+  }
+  double mean = sum / values.size();
+  double squares = 0.0;
+  for (size_t i = 0; i < values.size(); i++)
+  {
+    squares += (values[i] - mean) * (values[i] - mean);
+  }
+
+  std::sort(values.begin(), values.end());
+  double p50 = values[values.size() / 2];
+  for (size_t i = 0; i < values.size(); i++)
+  {
+    values[i] = fabs(values[i]);
+  }
+  std::sort(values.begin(), values.end());
+  double p95_abs = values[(values.size() * 95) / 100 < values.size() ? (values.size() * 95) / 100 : values.size() - 1];
+
+  printf(",\"%s\":{\"mean\":%.4f,\"sd\":%.4f,\"p50\":%.4f,\"p95_abs\":%.4f,\"max_abs\":%.4f}",
+         name, mean, sqrt(squares / values.size()), p50, p95_abs, values.back());
+}
+
+static void print_errors(const engine_t *engine, const errors_t *errors)
+{
+  printf(",\"shots\":%u,\"missed\":%u,\"spurious\":%u", errors->shots, errors->missed, errors->spurious);
+  print_distribution("shutter_err_us", errors->shutter_us);
+  print_distribution("ev_err", errors->ev);
+  print_distribution("curtain_1_err_us", errors->curtain_1_us);
+  print_distribution("curtain_2_err_us", errors->curtain_2_us);
+  double calls_per_shot = errors->shots ? (double)errors->isr_calls / errors->shots : 0.0;
+  printf(",\"isr_calls_per_shot\":%.2f,\"isr_busy_us_per_shot\":%.2f,\"host_ns_per_shot\":%.1f}\n",
+         calls_per_shot,
+         calls_per_shot * engine->service_ns / 1000.0,
+         errors->shots ? errors->host_ns / errors->shots : 0.0);
+}
+
+//---------------------------------------------------
+// Host time to format the values of one display
+// update, the same conversions as tft_show_values()
+//---------------------------------------------------
+static void benchmark_display()
+{
+  const int updates = 100000;
+  char buffer[15];
+  volatile size_t length = 0;
+  host_clock::time_point begin = host_clock::now();
+  for (int i = 0; i < updates; i++)
+  {
+    double ms = 1.0 + (i % 1000) * 0.125;
+    length += snprintf(buffer, sizeof(buffer), "%0.0f", 1000.0 / ms);
+    length += snprintf(buffer, sizeof(buffer), "%0.0f", 1000.0 / (ms + 0.1));
+    length += snprintf(buffer, sizeof(buffer), "%0.0f", 1000.0 / (ms + 0.2));
+    length += snprintf(buffer, sizeof(buffer), "%0.1fms", ms);
+    length += snprintf(buffer, sizeof(buffer), "%0.1fms", ms + 0.1);
+    length += snprintf(buffer, sizeof(buffer), "%0.1fms", ms + 0.2);
+    length += snprintf(buffer, sizeof(buffer), "%0.1f", ms * 8.0);
+    length += snprintf(buffer, sizeof(buffer), "%0.1f", ms * 8.3);
+  }
+  printf("{\"type\":\"display\",\"host_ns_per_update\":%.1f}\n", host_elapsed_ns(begin) / updates);
+}
+
+//---------------------------------------------------
+// Usage: program [shots per scenario] [seed]
+//---------------------------------------------------
+int main(int argc, char **argv)
+{
+  uint32_t shots_per_scenario = argc > 1 ? strtoul(argv[1], NULL, 10) : SHOTS_PER_SCENARIO;
+  uint64_t seed = argc > 2 ? strtoull(argv[2], NULL, 10) : DEFAULT_SEED;
+  if (shots_per_scenario == 0 || seed == 0)
+  {
+    fprintf(stderr, "usage: %s [shots per scenario] [seed]\n", argv[0]);
+    return 1;
+  }
+
+  printf("{\"type\":\"run\",\"version\":\"%d.%d.%d\",\"shots_per_scenario\":%u,\"seed\":%llu,"
+         "\"filter_width_us\":%u,\"loop_poll_us\":%.0f}\n",
+         VERSION_MAJOR, VERSION_MINOR, VERSION_REV, shots_per_scenario, (unsigned long long)seed,
+         EDGE_FILTER_DEFAULT_WIDTH_US, LOOP_POLL_NS / 1000.0);
+  benchmark_display();
+
+  shot_t shot;
+  shot_result_t result;
+  std::vector<isr_call_t> calls;
+  errors_t errors;
+  errors_t summary;
+
+  for (uint8_t e = 0; e < ENGINES; e++)
+  {
+    const engine_t *engine = &engines[e];
+
+    // the filter works in timestamp counts, its width is a single
+    // byte so input capture gets 255 counts (16us), which is plenty
+    // as there is no interrupt latency in its timestamps
+    edge_filter_set_width((uint8_t)std::min(255.0, EDGE_FILTER_DEFAULT_WIDTH_US * 1000.0 / engine->unit_ns));
+    edge_filter_set_hold((uint32_t)(EDGE_FILTER_DEFAULT_HOLD_US * 1000.0 / engine->unit_ns));
+
+    for (uint8_t calibrated = 0; calibrated < 2; calibrated++)
+    {
+      errors_clear(&summary);
+      for (uint8_t t = 0; t < TRAVELS; t++)
+      {
+        for (uint8_t d = 0; d < DISTURBANCES; d++)
+        {
+          for (uint8_t s = 0; s < SPEEDS; s++)
+          {
+            // every engine and calibration sees the same shots
+            shot_rng = seed + 1000 * t + 100 * d + s;
+            engine_rng = ~shot_rng;
+            if (calibrated)
+            {
+              calibrate_engine(engine);
+            }
+            else
+            {
+              calibration_clear();
+            }
+
+            double nominal_ns = 1e9 / denominators[s];
+            errors_clear(&errors);
+            for (uint32_t n = 0; n < shots_per_scenario; n++)
+            {
+              make_shot(&shot, nominal_ns, &travels[t], (disturbance_t)d);
+              capture(engine, shot.sensors, shot.base_units, &calls);
+              process_shot(engine, &shot, calls, &result);
+
+              errors.shots++;
+              errors.spurious += result.spurious;
+              errors.isr_calls += calls.size();
+              errors.host_ns += result.host_ns;
+              if (!result.speed_taken)
+              {
+                errors.missed++;
+                continue;
+              }
+              double true_ns = shot.close_ns[1] - shot.open_ns[1];
+              errors.shutter_us.push_back((result.shutter_ns - true_ns) / 1000.0);
+              if (result.shutter_ns > 0.0)
+              {
+                errors.ev.push_back(log2(result.shutter_ns / true_ns));
+              }
+              if (result.curtains_taken)
+              {
+                errors.curtain_1_us.push_back((result.curtain_1_ns - fabs(shot.open_ns[2] - shot.open_ns[0])) / 1000.0);
+                errors.curtain_2_us.push_back((result.curtain_2_ns - fabs(shot.close_ns[2] - shot.close_ns[0])) / 1000.0);
+              }
+            }
+
+            printf("{\"type\":\"accuracy\",\"engine\":\"%s\",\"calibrated\":%s,\"travel\":\"%s\","
+                   "\"disturbance\":\"%s\",\"speed\":\"1/%u\"",
+                   engine->name, calibrated ? "true" : "false", travels[t].name,
+                   disturbance_names[d], denominators[s]);
+            print_errors(engine, &errors);
+            errors_append(&summary, &errors);
+          }
+        }
+      }
+      printf("{\"type\":\"summary\",\"engine\":\"%s\",\"calibrated\":%s",
+             engine->name, calibrated ? "true" : "false");
+      print_errors(engine, &summary);
+    }
+  }
+  return 0;
+}
+
+#endif /* PIO_UNIT_TESTING */
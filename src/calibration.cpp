@@ -0,0 +1,157 @@
+#ifdef ARDUINO
+#include <EEPROM.h>
+#endif
+#include <string.h>
+
+#include "calibration.h"
+
+// where the offsets are kept in EEPROM, the magic number
+// changes whenever the layout of calibration_t does
+#define CALIBRATION_EEPROM_ADDRESS 0
+#define CALIBRATION_MAGIC 0xCA01
+
+typedef struct
+{
+  uint16_t magic;
+  calibration_t offsets;
+  uint8_t checksum;
+} calibration_record_t;
+
+static calibration_t offsets;
+
+// accumulated delays while calibrating
+static uint32_t on_sum_us[CALIBRATION_CHANNELS];
+static uint32_t off_sum_us[CALIBRATION_CHANNELS];
+static uint8_t on_count[CALIBRATION_CHANNELS];
+static uint8_t off_count[CALIBRATION_CHANNELS];
+
+//---------------------------------------------------
+// Simple sum of the stored offsets so a blank or
+// half written EEPROM is not used
+//---------------------------------------------------
+static uint8_t checksum(const calibration_t *cal)
+{
+  const uint8_t *bytes = (const uint8_t *)cal;
+  uint8_t sum = 0;
+  for (uint8_t i = 0; i < sizeof(calibration_t); i++)
+  {
+    sum += bytes[i];
+  }
+  return ~sum;
+}
+
+//---------------------------------------------------
+// Read the offsets from EEPROM at startup, no
+// correction is applied if nothing valid is stored.
+// The native benchmark build has no EEPROM and
+// always starts without offsets.
+//---------------------------------------------------
+void calibration_load()
+{
+  calibration_record_t record;
+#ifdef ARDUINO
+  EEPROM.get(CALIBRATION_EEPROM_ADDRESS, record);
+#else
+  memset(&record, 0, sizeof(record));
+#endif
+  if (record.magic == CALIBRATION_MAGIC && record.checksum == checksum(&record.offsets))
+  {
+    offsets = record.offsets;
+  }
+  else
+  {
+    memset(&offsets, 0, sizeof(offsets));
+  }
+}
+
+void calibration_save()
+{
+  calibration_record_t record;
+  record.magic = CALIBRATION_MAGIC;
+  record.offsets = offsets;
+  record.checksum = checksum(&offsets);
+#ifdef ARDUINO
+  EEPROM.put(CALIBRATION_EEPROM_ADDRESS, record); // only writes bytes that changed
+#endif
+}
+
+void calibration_clear()
+{
+  memset(&offsets, 0, sizeof(offsets));
+  calibration_save();
+}
+
+const calibration_t *calibration_get()
+{
+  return &offsets;
+}
+
+//---------------------------------------------------
+// Move a timestamp back by the channel's delay
+// so it is the time the light actually changed
+//---------------------------------------------------
+uint32_t calibration_start_us(uint8_t channel, uint32_t ts_us)
+{
+  return ts_us - (int32_t)offsets.light_on_us[channel];
+}
+
+uint32_t calibration_end_us(uint8_t channel, uint32_t ts_us)
+{
+  return ts_us - (int32_t)offsets.light_off_us[channel];
+}
+
+//---------------------------------------------------
+// Start a calibration run
+//---------------------------------------------------
+void calibration_begin()
+{
+  memset(on_sum_us, 0, sizeof(on_sum_us));
+  memset(off_sum_us, 0, sizeof(off_sum_us));
+  memset(on_count, 0, sizeof(on_count));
+  memset(off_count, 0, sizeof(off_count));
+}
+
+//---------------------------------------------------
+// Add the measured delay between a reference
+// light change and the channel's timestamp
+//---------------------------------------------------
+void calibration_add_sample(uint8_t channel, bool light_on, uint32_t delay_us)
+{
+  if (channel >= CALIBRATION_CHANNELS || delay_us > INT16_MAX)
+  {
+    return;
+  }
+  if (light_on && on_count[channel] < UINT8_MAX)
+  {
+    on_sum_us[channel] += delay_us;
+    on_count[channel]++;
+  }
+  else if (!light_on && off_count[channel] < UINT8_MAX)
+  {
+    off_sum_us[channel] += delay_us;
+    off_count[channel]++;
+  }
+}
+
+//---------------------------------------------------
+// Average the samples into new offsets and store them.
+// Returns false, leaving the old offsets in place,
+// if any channel did not see both kinds of edge
+//---------------------------------------------------
+bool calibration_finish()
+{
+  for (uint8_t i = 0; i < CALIBRATION_CHANNELS; i++)
+  {
+    if (on_count[i] == 0 || off_count[i] == 0)
+    {
+      return false;
+    }
+  }
+  for (uint8_t i = 0; i < CALIBRATION_CHANNELS; i++)
+  {
+    offsets.light_on_us[i] = (on_sum_us[i] + on_count[i] / 2) / on_count[i];
+    offsets.light_off_us[i] = (off_sum_us[i] + off_count[i] / 2) / off_count[i];
+  }
+  calibration_save();
+  return true;
+}
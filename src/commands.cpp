@@ -0,0 +1,213 @@
+#include <Arduino.h>
+#include <stdarg.h>
+
+#include "commands.h"
+
+// Line based command interface on the serial port.
+//
+// Nothing in here blocks: each call to commands_poll() reads at most
+// COMMAND_RX_BYTES_PER_POLL bytes that have already arrived, and only
+// moves queued output into the hardware transmit buffer when there is
+// room for it. This keeps the time spent per pass through loop() small
+// and bounded so command handling does not delay edge processing.
+//
+// Commands are terminated by a new line (CR is ignored), the command
+// name is not case sensitive. Every command answers with zero or more
+// lines of "key=value" pairs followed by "OK" or "ERR <reason>".
+// Lines starting with '!' report events and can arrive at any time.
+
+#define COMMAND_RX_BUFFER_SIZE 32
+#define COMMAND_TX_BUFFER_SIZE 160
+#define COMMAND_RX_BYTES_PER_POLL 8
+
+// the received line being assembled
+static char rx_line[COMMAND_RX_BUFFER_SIZE];
+static uint8_t rx_length = 0;
+static bool rx_overflow = false;
+
+// queued output, a ring buffer
+static char tx_queue[COMMAND_TX_BUFFER_SIZE];
+static uint8_t tx_head = 0;
+static uint8_t tx_count = 0;
+
+static const command_t *command_table = NULL; // in PROGMEM
+static uint8_t command_count = 0;
+
+// a command that has more lines to send
+static command_handler_t active_handler = NULL;
+static const char *active_args = NULL;
+static uint8_t active_step = 0;
+
+//---------------------------------------------------
+// Queue a string for transmission, a string that
+// does not fit in the queue is dropped whole
+//---------------------------------------------------
+static void tx_enqueue(const char *text)
+{
+  if (strlen(text) > (size_t)(COMMAND_TX_BUFFER_SIZE - tx_count))
+  {
+    return;
+  }
+  while (*text)
+  {
+    tx_queue[(tx_head + tx_count) % COMMAND_TX_BUFFER_SIZE] = *text++;
+    tx_count++;
+  }
+}
+
+//---------------------------------------------------
+// Move as much queued output as the hardware
+// transmit buffer will take without waiting
+//---------------------------------------------------
+static void tx_drain()
+{
+  int room = Serial.availableForWrite();
+  while (room > 0 && tx_count > 0)
+  {
+    Serial.write(tx_queue[tx_head]);
+    tx_head = (tx_head + 1) % COMMAND_TX_BUFFER_SIZE;
+    tx_count--;
+    room--;
+  }
+}
+
+//---------------------------------------------------
+// Run a step of a command and keep it active if
+// it has more to say
+//---------------------------------------------------
+static void run_step(command_handler_t handler, const char *args, uint8_t step)
+{
+  if (handler(args, step))
+  {
+    active_handler = handler;
+    active_args = args;
+    active_step = step;
+  }
+  else
+  {
+    active_handler = NULL;
+  }
+}
+
+//---------------------------------------------------
+// Split the received line into command and
+// arguments and call the matching handler
+//---------------------------------------------------
+static void dispatch()
+{
+  char *name = rx_line;
+  while (*name == ' ')
+  {
+    name++;
+  }
+  if (*name == '\0')
+  {
+    return;
+  }
+
+  char *args = name;
+  while (*args && *args != ' ')
+  {
+    args++;
+  }
+  if (*args)
+  {
+    *args++ = '\0';
+    while (*args == ' ')
+    {
+      args++;
+    }
+  }
+
+  for (uint8_t i = 0; i < command_count; i++)
+  {
+    command_t command;
+    memcpy_P(&command, &command_table[i], sizeof(command));
+    if (strcasecmp_P(name, command.name) == 0)
+    {
+      run_step(command.handler, args, 0);
+      return;
+    }
+  }
+  commands_printf_P(PSTR("ERR unknown command\r\n"));
+}
+
+//---------------------------------------------------
+// Called once at startup with the table of
+// commands, Serial must already be running
+//---------------------------------------------------
+void commands_setup(const command_t *table, uint8_t count)
+{
+  command_table = table;
+  command_count = count;
+}
+
+//---------------------------------------------------
+// Called on every pass through loop() to do a
+// bounded amount of receive and transmit work
+//---------------------------------------------------
+void commands_poll()
+{
+  tx_drain();
+
+  // only start something new when a whole line of output will fit
+  if (COMMAND_TX_BUFFER_SIZE - tx_count < COMMAND_LINE_MAX)
+  {
+    return;
+  }
+
+  // a multi line response holds off reading more input,
+  // anything sent meanwhile waits in the hardware receive buffer
+  if (active_handler)
+  {
+    run_step(active_handler, active_args, active_step + 1);
+    return;
+  }
+
+  for (uint8_t i = 0; i < COMMAND_RX_BYTES_PER_POLL && Serial.available() > 0; i++)
+  {
+    char c = Serial.read();
+    if (c == '\r')
+    {
+      continue;
+    }
+    if (c == '\n')
+    {
+      rx_line[rx_length] = '\0';
+      if (rx_overflow)
+      {
+        commands_printf_P(PSTR("ERR line too long\r\n"));
+      }
+      else
+      {
+        dispatch();
+      }
+      rx_length = 0;
+      rx_overflow = false;
+      return;
+    }
+    if (rx_length < COMMAND_RX_BUFFER_SIZE - 1)
+    {
+      rx_line[rx_length++] = c;
+    }
+    else
+    {
+      rx_overflow = true;
+    }
+  }
+}
+
+//---------------------------------------------------
+// Format a line of output (format string in flash)
+// and add it to the transmit queue
+//---------------------------------------------------
+void commands_printf_P(const char *format_P, ...)
+{
+  char buffer[COMMAND_LINE_MAX];
+  va_list args;
+
+  va_start(args, format_P);
+  vsnprintf_P(buffer, sizeof(buffer), format_P, args);
+  va_end(args);
+  tx_enqueue(buffer);
+}
@@ -0,0 +1,109 @@
+#include "edge_filter.h"
+
+// A single byte so the interrupts always see a whole value.
+// Zero turns the filter off.
+static volatile uint8_t width_us = EDGE_FILTER_DEFAULT_WIDTH_US;
+
+void edge_filter_set_width(uint8_t new_width_us)
+{
+  width_us = new_width_us;
+}
+
+uint8_t edge_filter_width()
+{
+  return width_us;
+}
+
+// Only changed before the interrupts are attached,
+// by the benchmark which counts in other units
+static uint32_t hold_us = EDGE_FILTER_DEFAULT_HOLD_US;
+
+void edge_filter_set_hold(uint32_t new_hold_us)
+{
+  hold_us = new_hold_us;
+}
+
+//---------------------------------------------------
+// Start a channel from scratch with the current
+// light level
+//---------------------------------------------------
+void edge_filter_reset(volatile edge_channel_t *channel, bool light)
+{
+  channel->start_us = 0;
+  channel->end_us = 0;
+  channel->speed_measured = false;
+  channel->curtain_measured = false;
+  channel->curtain_start_us = 0;
+  channel->curtain_end_us = 0;
+  channel->rejected = 0;
+  channel->light = light;
+  channel->pending = false;
+}
+
+//---------------------------------------------------
+// Called from the detector interrupt with the new
+// light level and the time it changed
+//---------------------------------------------------
+void edge_filter_edge(volatile edge_channel_t *channel, bool light, uint32_t now_us)
+{
+  // The opposite edge came too soon, the last edge was a glitch
+  if (channel->pending && light != channel->light && (now_us - channel->edge_us) < width_us)
+  {
+    channel->start_us = channel->undo_start_us;
+    channel->end_us = channel->undo_end_us;
+    channel->speed_measured = channel->undo_speed_measured;
+    channel->curtain_measured = channel->undo_curtain_measured;
+    channel->light = light;
+    channel->pending = false;
+    channel->rejected++;
+    return;
+  }
+
+  // No change in level means the opposite edge was too
+  // short to be seen at all
+  if (light == channel->light)
+  {
+    channel->rejected++;
+    return;
+  }
+
+  channel->undo_start_us = channel->start_us;
+  channel->undo_end_us = channel->end_us;
+  channel->undo_speed_measured = channel->speed_measured;
+  channel->undo_curtain_measured = channel->curtain_measured;
+  channel->edge_us = now_us;
+  channel->pending = true;
+  channel->light = light;
+
+  // the curtain times only change when nothing is held, so
+  // undoing the flag is enough to undo them
+  if (light)
+  {
+    channel->start_us = now_us;
+    channel->speed_measured = false;
+    if (channel->curtain_measured && (now_us - channel->curtain_end_us) >= hold_us)
+    {
+      channel->curtain_measured = false;
+    }
+  }
+  else
+  {
+    channel->end_us = now_us;
+    channel->speed_measured = true;
+    if (!channel->curtain_measured)
+    {
+      channel->curtain_start_us = channel->start_us;
+      channel->curtain_end_us = now_us;
+      channel->curtain_measured = true;
+    }
+  }
+}
+
+//---------------------------------------------------
+// True once the last edge can no longer be undone.
+// Call with interrupts off.
+//---------------------------------------------------
+bool edge_filter_settled(volatile edge_channel_t *channel, uint32_t now_us)
+{
+  return !channel->pending || (now_us - channel->edge_us) >= width_us;
+}
@@ -8,8 +8,19 @@
 // choose which screen to use
 // 0.96" OLED - connected via I2C
 // 2.2"  TFT - connected via SPI
+// these can also be set from the build flags in platformio.ini
+#ifndef USE_OLED
 #define USE_OLED 0
+#endif
+#ifndef USE_TFT
 #define USE_TFT 1
+#endif
+
+// Accept commands on the serial port so a test rig can arm the
+// tester, select a mode, fetch statistics and dump the log
+#ifndef USE_SERIAL_COMMANDS
+#define USE_SERIAL_COMMANDS 1
+#endif
 
 #if USE_OLED
 #include "oled.h"
@@ -19,30 +30,40 @@
 #include "tft.h"
 #endif
 
+#if USE_SERIAL_COMMANDS
+#include "commands.h"
+#include "version.h"
+#include "stats.h"
+#include "session.h"
+#include "timebase.h"
+#endif
+
+#include "memory.h"
+#include "calibration.h"
+#include "edge_filter.h"
+#include "measure.h"
+
 // pins for KY-008 Laser Diodes
 #define LASER_DIODE_1_OUTPUT 5
 #define LASER_DIODE_2_OUTPUT 6
 #define LASER_DIODE_3_OUTPUT 7
 
+#if USE_SERIAL_COMMANDS
+// the laser diode pins must all be on the same port, calibration
+// switches them one at a time with a single write to it
+volatile uint8_t *laser_port = NULL;
+uint8_t laser_masks[3]; // one per laser
+uint8_t laser_mask = 0; // all of them
+#endif
+
 // pins for ISO203 Laser Receivers
 #define LASER_RECEIVER_1_INPUT 2
 #define LASER_RECEIVER_2_INPUT 3
 #define LASER_RECEIVER_3_INPUT 4
 
-// variables set in interrupts
-volatile uint32_t ts_1_start_us = 0;
-volatile uint32_t ts_1_end_us = 0;
-volatile bool speed_1_measured = false;
-volatile bool curtain_1_measured = false;
-
-volatile uint32_t ts_2_start_us = 0;
-volatile uint32_t ts_2_end_us = 0;
-volatile bool speed_2_measured = false;
-
-volatile uint32_t ts_3_start_us = 0;
-volatile uint32_t ts_3_end_us = 0;
-volatile bool speed_3_measured = false;
-volatile bool curtain_2_measured = false;
+// variables set in interrupts, one per detector
+#define DETECTORS 3
+volatile edge_channel_t detectors[DETECTORS];
 
 // variables for calculated values
 double shutter_speed_1_ms = 0.0;
@@ -54,74 +75,722 @@ double fractional_shutter_speed_3 = 0.0;
 double curtain_1_travel_time_ms = 0.0;
 double curtain_2_travel_time_ms = 0.0;
 
+// Measurements are ignored while disarmed and for a short time after
+// arming, so the edges caused by turning the lasers on are not measured
+#define ARM_SETTLE_MS 50
+bool armed = false;
+uint32_t armed_at_ms = 0;
+
+// Operating modes. Only the serial commands select anything other
+// than normal, so without them the other modes, the statistics and
+// their state are left out.
+enum tester_mode_t
+{
+  MODE_NORMAL,
+  MODE_CALIBRATE,
+  MODE_SESSION,
+  MODE_LONG,
+  MODE_COUNT
+};
+tester_mode_t mode = MODE_NORMAL;
+
+#if USE_SERIAL_COMMANDS
+// names for the serial commands, all in PROGMEM
+const char mode_normal[] PROGMEM = "normal";
+const char mode_calibrate[] PROGMEM = "calibrate";
+const char mode_session[] PROGMEM = "session";
+const char mode_long[] PROGMEM = "long";
+const char *const mode_names[MODE_COUNT] PROGMEM = {mode_normal, mode_calibrate, mode_session, mode_long};
+
+// Calibration switches each laser off and on a number of times, one
+// channel at a time, and measures how long the channel takes to see the
+// change. When finished it goes back to normal mode.
+#define CALIBRATION_PULSES 16
+#define CALIBRATION_HALF_PERIOD_MS 20
+enum calibration_status_t
+{
+  CALIBRATION_NONE,
+  CALIBRATION_RUNNING,
+  CALIBRATION_OK,
+  CALIBRATION_FAILED
+};
+const char calibration_none[] PROGMEM = "none";
+const char calibration_running[] PROGMEM = "running";
+const char calibration_ok[] PROGMEM = "ok";
+const char calibration_failed[] PROGMEM = "failed";
+const char *const calibration_status_names[] PROGMEM = {calibration_none, calibration_running, calibration_ok, calibration_failed};
+calibration_status_t calibration_status = CALIBRATION_NONE;
+uint8_t calibration_edges = 0;
+uint32_t calibration_edge_us = 0;
+uint32_t calibration_edge_ms = 0;
+
+// Long exposure mode times B and T exposures on the centre sensor with
+// the 64 bit timebase, so there is no wrap error however long they are,
+// at micros() resolution (4us), and shows the elapsed time while the
+// shutter is open
+#define LONG_EXPOSURE_UPDATE_MS 200
+bool long_exposure_open = false;
+uint32_t long_exposure_start_ts_us = 0; // raw timestamp of the edge that opened it
+uint64_t long_exposure_start_us = 0;
+uint64_t long_exposure_us = 0; // elapsed while open, otherwise the last exposure
+uint32_t long_exposure_shown_ms = 0;
+
+// set when a session ends so the summary table is shown next
+bool show_session_table = false;
+#endif
+
 // display update delay
 #define DISPLAY_UPDATE_TRIGGER (UINT16_MAX / 2)
 uint32_t display_update_counter = DISPLAY_UPDATE_TRIGGER;
 
+// how long the last and the slowest display update took,
+// and the slowest pass through loop(), for the perf command
+uint32_t display_update_us = 0;
+uint32_t display_update_max_us = 0;
+uint32_t loop_max_us = 0;
+
 //---------------------------------------------------
-// Detector 1 interrupt handler
+// Detector interrupt handlers. The receiver output
+// is low while the laser light reaches it.
+// The time is read first as it is what matters.
 //---------------------------------------------------
 void detector1(void)
 {
-  if (digitalRead(LASER_RECEIVER_1_INPUT))
+  uint32_t now_us = micros();
+  edge_filter_edge(&detectors[0], digitalRead(LASER_RECEIVER_1_INPUT) == LOW, now_us);
+}
+
+void detector2(void)
+{
+  uint32_t now_us = micros();
+  edge_filter_edge(&detectors[1], digitalRead(LASER_RECEIVER_2_INPUT) == LOW, now_us);
+}
+
+void detector3(void)
+{
+  uint32_t now_us = micros();
+  edge_filter_edge(&detectors[2], digitalRead(LASER_RECEIVER_3_INPUT) == LOW, now_us);
+}
+
+//---------------------------------------------------
+// Take a shutter time from a detector once its last
+// edge has settled, with the calibration applied
+//---------------------------------------------------
+bool take_speed(uint8_t detector, uint32_t *start_us, uint32_t *end_us)
+{
+  noInterrupts();
+  bool measured = measure_take_speed(detectors, detector, micros(), start_us, end_us);
+  interrupts();
+  return measured;
+}
+
+//---------------------------------------------------
+// Take the curtain travel times once both outer
+// detectors have seen a whole exposure
+//---------------------------------------------------
+bool take_curtains(uint32_t *curtain_1_us, uint32_t *curtain_2_us)
+{
+  noInterrupts();
+  bool measured = measure_take_curtains(detectors, micros(), curtain_1_us, curtain_2_us);
+  interrupts();
+  return measured;
+}
+
+//---------------------------------------------------
+// Turn the lasers on or off and start or stop measuring
+//---------------------------------------------------
+void set_armed(bool on)
+{
+  digitalWrite(LASER_DIODE_1_OUTPUT, on ? HIGH : LOW);
+  digitalWrite(LASER_DIODE_2_OUTPUT, on ? HIGH : LOW);
+  digitalWrite(LASER_DIODE_3_OUTPUT, on ? HIGH : LOW);
+  armed_at_ms = millis();
+  armed = on;
+}
+
+#if USE_SERIAL_COMMANDS
+//---------------------------------------------------
+// One line of the session summary, with the prefix
+// "!" it reports a group that has just closed
+//---------------------------------------------------
+void print_session_row(const char *prefix, const session_row_t *row)
+{
+  commands_printf_P(PSTR("%s1/%u n=%u mean_us=%lu ev=%+.2f spread_us=%lu c1_us=%lu c2_us=%lu\r\n"),
+                    prefix,
+                    row->denominator,
+                    row->count,
+                    (unsigned long)row->mean_us,
+                    row->ev_error,
+                    (unsigned long)row->spread_us,
+                    (unsigned long)row->curtain_1_us,
+                    (unsigned long)row->curtain_2_us);
+}
+
+//---------------------------------------------------
+// Change the operating mode
+//---------------------------------------------------
+void set_mode(tester_mode_t new_mode)
+{
+  // selecting the session again keeps the groups collected so far
+  if (new_mode == MODE_SESSION && mode == MODE_SESSION)
   {
-    ts_1_end_us = micros();
-    speed_1_measured = true;
-    curtain_1_measured = true;
+    return;
   }
-  else
+
+  // finish the old mode
+  if (mode == MODE_CALIBRATE)
+  {
+    if (calibration_status == CALIBRATION_RUNNING)
+    {
+      calibration_status = CALIBRATION_NONE;
+    }
+    set_armed(armed);
+  }
+  else if (mode == MODE_SESSION)
+  {
+    // report the last group as loop() does when a group closes
+    session_row_t row;
+    int8_t closed = session_end();
+    if (closed >= 0 && session_setting_row(closed, &row))
+    {
+      print_session_row("!", &row);
+    }
+    show_session_table = true;
+  }
+
+  // and start the new one
+  if (new_mode == MODE_CALIBRATE)
   {
-    ts_1_start_us = micros();
-    speed_1_measured = false;
-    curtain_1_measured = false;
+    // start with the lasers on and give them time to settle
+    *laser_port |= laser_mask;
+    calibration_begin();
+    calibration_status = CALIBRATION_RUNNING;
+    calibration_edges = 0;
+    calibration_edge_ms = millis();
   }
+  else if (new_mode == MODE_SESSION)
+  {
+    session_begin();
+  }
+  else if (new_mode == MODE_LONG)
+  {
+    // only an edge after this counts as the shutter opening
+    noInterrupts();
+    long_exposure_start_ts_us = detectors[1].start_us;
+    interrupts();
+    long_exposure_open = false;
+    long_exposure_us = 0;
+  }
+  mode = new_mode;
+  display_update_counter = 0;
 }
 
 //---------------------------------------------------
-// Detector 2 interrupt handler
+// Called from loop() while calibrating, makes the
+// next laser edge once the last one has been seen
 //---------------------------------------------------
-void detector2(void)
+void run_calibration()
 {
-  if (digitalRead(LASER_RECEIVER_2_INPUT))
+  if (millis() - calibration_edge_ms < CALIBRATION_HALF_PERIOD_MS)
   {
-    ts_2_end_us = micros();
-    speed_2_measured = true;
+    return;
+  }
+
+  // Each pair of edges turns one laser off and back on. Only one
+  // receiver changes at a time, as in a real shot, so its delay does
+  // not include waiting for the other receivers' handlers, which
+  // share the pin change interrupt.
+  // Timestamps from before the edge wrap round to a huge delay and
+  // are ignored by calibration_add_sample()
+  if (calibration_edges > 0)
+  {
+    uint8_t channel = ((calibration_edges - 1) / 2) % DETECTORS;
+    bool light_on = (calibration_edges % 2) == 0;
+    noInterrupts();
+    uint32_t ts_us = light_on ? detectors[channel].start_us : detectors[channel].end_us;
+    interrupts();
+    calibration_add_sample(channel, light_on, ts_us - calibration_edge_us);
+  }
+
+  if (calibration_edges == CALIBRATION_PULSES * 2 * DETECTORS)
+  {
+    calibration_status = calibration_finish() ? CALIBRATION_OK : CALIBRATION_FAILED;
+    set_mode(MODE_NORMAL);
+    return;
+  }
+
+  calibration_edges++;
+  uint8_t mask = laser_masks[((calibration_edges - 1) / 2) % DETECTORS];
+  noInterrupts();
+  calibration_edge_us = micros();
+  if (calibration_edges % 2)
+  {
+    *laser_port &= ~mask;
   }
   else
   {
-    ts_2_start_us = micros();
-    speed_2_measured = false;
+    *laser_port |= mask;
   }
+  interrupts();
+  calibration_edge_ms = millis();
 }
 
 //---------------------------------------------------
-// Detector 3 interrupt handler
+// Show the long exposure time on the display
 //---------------------------------------------------
-void detector3(void)
+void show_long_exposure()
+{
+  uint32_t seconds = long_exposure_us / 1000000;
+  uint32_t fraction_us = long_exposure_us % 1000000;
+
+#if USE_OLED
+  oled_show_elapsed(seconds, fraction_us, long_exposure_open);
+#endif
+
+#if USE_TFT
+  tft_show_elapsed(seconds, fraction_us, long_exposure_open);
+#endif
+  long_exposure_shown_ms = millis();
+}
+
+//---------------------------------------------------
+// Called from loop() in long exposure mode to time
+// the centre sensor and keep the display going
+//---------------------------------------------------
+void run_long_exposure(bool measuring)
 {
-  if (digitalRead(LASER_RECEIVER_3_INPUT))
+  volatile edge_channel_t *channel = &detectors[1];
+
+  noInterrupts();
+  uint32_t now_us = micros();
+  bool settled = edge_filter_settled(channel, now_us);
+  bool light = channel->light;
+  bool ended = settled && channel->speed_measured;
+  uint32_t start_ts_us = channel->start_us;
+  uint32_t end_ts_us = channel->end_us;
+  if (ended || !measuring)
   {
-    ts_3_end_us = micros();
-    speed_3_measured = true;
-    curtain_2_measured = true;
+    channel->speed_measured = false;
   }
-  else
+  timebase_update(now_us);
+  interrupts();
+
+  if (!measuring)
+  {
+    long_exposure_open = false;
+    long_exposure_start_ts_us = start_ts_us;
+    return;
+  }
+
+  if (!long_exposure_open && settled && light && start_ts_us != long_exposure_start_ts_us)
+  {
+    long_exposure_open = true;
+    long_exposure_start_ts_us = start_ts_us;
+    long_exposure_start_us = timebase_extend(calibration_start_us(1, start_ts_us));
+  }
+
+  if (ended)
+  {
+    // a short exposure can open and close between two passes
+    if (!long_exposure_open)
+    {
+      long_exposure_start_us = timebase_extend(calibration_start_us(1, start_ts_us));
+    }
+    long_exposure_us = timebase_extend(calibration_end_us(1, end_ts_us)) - long_exposure_start_us;
+    long_exposure_open = false;
+    long_exposure_start_ts_us = start_ts_us;
+    stats_add_speed(1, (uint32_t)long_exposure_start_us, long_exposure_us > UINT32_MAX ? UINT32_MAX : (uint32_t)long_exposure_us);
+    show_long_exposure();
+    commands_printf_P(PSTR("!long s=%lu fraction_us=%lu\r\n"),
+                      (unsigned long)(long_exposure_us / 1000000),
+                      (unsigned long)(long_exposure_us % 1000000));
+  }
+  else if (long_exposure_open && (millis() - long_exposure_shown_ms) >= LONG_EXPOSURE_UPDATE_MS)
   {
-    ts_3_start_us = micros();
-    speed_3_measured = false;
-    curtain_2_measured = false;
+    long_exposure_us = timebase_now_us() - long_exposure_start_us;
+    show_long_exposure();
   }
 }
 
+//---------------------------------------------------
+// Serial command handlers, see commands.h
+//---------------------------------------------------
+bool cmd_help(const char *args, uint8_t step);
+
+bool cmd_version(const char *args, uint8_t step)
+{
+  commands_printf_P(PSTR("version=%i.%i.%i\r\nOK\r\n"), VERSION_MAJOR, VERSION_MINOR, VERSION_REV);
+  return false;
+}
+
+bool cmd_arm(const char *args, uint8_t step)
+{
+  set_armed(true);
+  commands_printf_P(PSTR("armed=1\r\nOK\r\n"));
+  return false;
+}
+
+bool cmd_disarm(const char *args, uint8_t step)
+{
+  set_armed(false);
+  commands_printf_P(PSTR("armed=0\r\nOK\r\n"));
+  return false;
+}
+
+bool cmd_mode(const char *args, uint8_t step)
+{
+  if (step == 0 && *args)
+  {
+    uint8_t i = 0;
+    while (i < MODE_COUNT && strcasecmp_P(args, (PGM_P)pgm_read_ptr(&mode_names[i])) != 0)
+    {
+      i++;
+    }
+    if (i == MODE_COUNT)
+    {
+      commands_printf_P(PSTR("ERR unknown mode\r\n"));
+      return false;
+    }
+    // set_mode() may report the last session group, the reply follows
+    set_mode((tester_mode_t)i);
+    return true;
+  }
+  commands_printf_P(PSTR("mode=%S\r\nOK\r\n"), (PGM_P)pgm_read_ptr(&mode_names[mode]));
+  return false;
+}
+
+bool cmd_stats(const char *args, uint8_t step)
+{
+  const stats_accumulator_t *acc;
+
+  if (step < STATS_CHANNELS + 2)
+  {
+    if (step < STATS_CHANNELS)
+    {
+      acc = stats_speed(step);
+      commands_printf_P(PSTR("speed%u "), step + 1);
+    }
+    else
+    {
+      acc = stats_curtain(step - STATS_CHANNELS);
+      commands_printf_P(PSTR("curtain%u "), step - STATS_CHANNELS + 1);
+    }
+    commands_printf_P(PSTR("n=%u min_us=%lu max_us=%lu mean_us=%lu\r\n"),
+                      acc->count,
+                      (unsigned long)acc->min_us,
+                      (unsigned long)acc->max_us,
+                      (unsigned long)(acc->count ? acc->sum_us / acc->count : 0));
+    return true;
+  }
+  commands_printf_P(PSTR("OK\r\n"));
+  return false;
+}
+
+bool cmd_log(const char *args, uint8_t step)
+{
+  if (step < stats_log_count())
+  {
+    const stats_log_entry_t *entry = stats_log_entry(step);
+    if (entry->kind == STATS_LOG_CURTAIN)
+    {
+      commands_printf_P(PSTR("curtain c1_us=%lu c2_us=%lu\r\n"),
+                        (unsigned long)entry->a_us,
+                        (unsigned long)entry->b_us);
+    }
+    else
+    {
+      commands_printf_P(PSTR("speed%u us=%lu start_us=%lu\r\n"),
+                        entry->kind - STATS_LOG_SPEED_1 + 1,
+                        (unsigned long)entry->a_us,
+                        (unsigned long)entry->b_us);
+    }
+    return true;
+  }
+  commands_printf_P(PSTR("OK\r\n"));
+  return false;
+}
+
+bool cmd_cal(const char *args, uint8_t step)
+{
+  if (step == 0 && *args)
+  {
+    if (strcasecmp_P(args, PSTR("clear")) != 0)
+    {
+      commands_printf_P(PSTR("ERR unknown option\r\n"));
+      return false;
+    }
+    calibration_clear();
+    calibration_status = CALIBRATION_NONE;
+  }
+  if (step < CALIBRATION_CHANNELS)
+  {
+    const calibration_t *cal = calibration_get();
+    commands_printf_P(PSTR("channel%u on_us=%i off_us=%i\r\n"),
+                      step + 1,
+                      cal->light_on_us[step],
+                      cal->light_off_us[step]);
+    return true;
+  }
+  commands_printf_P(PSTR("status=%S\r\nOK\r\n"), (PGM_P)pgm_read_ptr(&calibration_status_names[calibration_status]));
+  return false;
+}
+
+bool cmd_session(const char *args, uint8_t step)
+{
+  session_row_t row;
+
+  if (step == 0 && *args && strcasecmp_P(args, PSTR("end")) != 0)
+  {
+    // declare the speed set on the dial, or go back to the nearest
+    long denominator = 0;
+    if (strcasecmp_P(args, PSTR("auto")) != 0)
+    {
+      char *end;
+      denominator = strtol(args, &end, 10);
+      if (end == args)
+      {
+        commands_printf_P(PSTR("ERR unknown option\r\n"));
+        return false;
+      }
+      if (*end || denominator <= 0 || denominator > UINT16_MAX)
+      {
+        denominator = -1;
+      }
+    }
+    if (denominator < 0 || !session_declare(denominator))
+    {
+      commands_printf_P(PSTR("ERR not a standard speed\r\n"));
+      return false;
+    }
+    commands_printf_P(PSTR("declared=%u\r\nOK\r\n"), session_declared());
+    return false;
+  }
+  if (step == 0 && *args)
+  {
+    // set_mode() reports the last group, the table follows
+    if (mode == MODE_SESSION)
+    {
+      set_mode(MODE_NORMAL);
+    }
+    return true;
+  }
+  if (session_row(*args ? step - 1 : step, &row))
+  {
+    print_session_row("", &row);
+    return true;
+  }
+  commands_printf_P(PSTR("OK\r\n"));
+  return false;
+}
+
+bool cmd_long(const char *args, uint8_t step)
+{
+  uint64_t exposure_us = long_exposure_us;
+  if (long_exposure_open)
+  {
+    noInterrupts();
+    timebase_update(micros());
+    interrupts();
+    exposure_us = timebase_now_us() - long_exposure_start_us;
+  }
+  commands_printf_P(PSTR("open=%u s=%lu fraction_us=%lu\r\nOK\r\n"),
+                    long_exposure_open,
+                    (unsigned long)(exposure_us / 1000000),
+                    (unsigned long)(exposure_us % 1000000));
+  return false;
+}
+
+bool cmd_mem(const char *args, uint8_t step)
+{
+  commands_printf_P(PSTR("static=%u heap=%u stack_peak=%u min_free=%u\r\nOK\r\n"),
+                    memory_static_bytes(),
+                    memory_heap_bytes(),
+                    memory_stack_peak_bytes(),
+                    memory_min_free_bytes());
+  return false;
+}
+
+bool cmd_perf(const char *args, uint8_t step)
+{
+  commands_printf_P(PSTR("display_us=%lu display_max_us=%lu loop_max_us=%lu\r\nOK\r\n"),
+                    display_update_us,
+                    display_update_max_us,
+                    loop_max_us);
+  return false;
+}
+
+bool cmd_filter(const char *args, uint8_t step)
+{
+  if (step == 0 && *args)
+  {
+    char *end;
+    long width_us = strtol(args, &end, 10);
+    while (*end == ' ')
+    {
+      end++;
+    }
+    if (end == args || *end)
+    {
+      commands_printf_P(PSTR("ERR width not a number\r\n"));
+      return false;
+    }
+    if (width_us < 0 || width_us > UINT8_MAX)
+    {
+      commands_printf_P(PSTR("ERR width out of range\r\n"));
+      return false;
+    }
+    edge_filter_set_width(width_us);
+  }
+  if (step == 0)
+  {
+    commands_printf_P(PSTR("width_us=%u\r\n"), edge_filter_width());
+    return true;
+  }
+  if (step <= DETECTORS)
+  {
+    noInterrupts();
+    uint16_t rejected = detectors[step - 1].rejected;
+    interrupts();
+    commands_printf_P(PSTR("channel%u rejected=%u\r\n"), step, rejected);
+    return true;
+  }
+  commands_printf_P(PSTR("OK\r\n"));
+  return false;
+}
+
+bool cmd_reset(const char *args, uint8_t step)
+{
+  stats_reset();
+  display_update_max_us = 0;
+  loop_max_us = 0;
+  for (uint8_t i = 0; i < DETECTORS; i++)
+  {
+    noInterrupts();
+    detectors[i].rejected = 0;
+    interrupts();
+  }
+  commands_printf_P(PSTR("OK\r\n"));
+  return false;
+}
+
+const char name_help[] PROGMEM = "help";
+const char name_version[] PROGMEM = "version";
+const char name_arm[] PROGMEM = "arm";
+const char name_disarm[] PROGMEM = "disarm";
+const char name_mode[] PROGMEM = "mode";
+const char name_stats[] PROGMEM = "stats";
+const char name_log[] PROGMEM = "log";
+const char name_cal[] PROGMEM = "cal";
+const char name_filter[] PROGMEM = "filter";
+const char name_session[] PROGMEM = "session";
+const char name_long[] PROGMEM = "long";
+const char name_mem[] PROGMEM = "mem";
+const char name_perf[] PROGMEM = "perf";
+const char name_reset[] PROGMEM = "reset";
+
+const command_t commands[] PROGMEM = {
+    {name_help, cmd_help},
+    {name_version, cmd_version},
+    {name_arm, cmd_arm},
+    {name_disarm, cmd_disarm},
+    {name_mode, cmd_mode},
+    {name_stats, cmd_stats},
+    {name_log, cmd_log},
+    {name_cal, cmd_cal},
+    {name_filter, cmd_filter},
+    {name_session, cmd_session},
+    {name_long, cmd_long},
+    {name_mem, cmd_mem},
+    {name_perf, cmd_perf},
+    {name_reset, cmd_reset},
+};
+#define COMMAND_COUNT (sizeof(commands) / sizeof(commands[0]))
+
+bool cmd_help(const char *args, uint8_t step)
+{
+  if (step < COMMAND_COUNT)
+  {
+    commands_printf_P(PSTR("%S\r\n"), (PGM_P)pgm_read_ptr(&commands[step].name));
+    return true;
+  }
+  commands_printf_P(PSTR("OK\r\n"));
+  return false;
+}
+#endif
+
+#if !USE_SERIAL_COMMANDS
+//---------------------------------------------------
+// Without the serial commands, answer each line
+// received with the memory use, in the same form as
+// the mem command, so the stack can still be measured
+//---------------------------------------------------
+void poll_memory_report()
+{
+  if (Serial.available() == 0 || Serial.read() != '\n')
+  {
+    return;
+  }
+  Serial.print(F("static="));
+  Serial.print(memory_static_bytes());
+  Serial.print(F(" heap="));
+  Serial.print(memory_heap_bytes());
+  Serial.print(F(" stack_peak="));
+  Serial.print(memory_stack_peak_bytes());
+  Serial.print(F(" min_free="));
+  Serial.print(memory_min_free_bytes());
+  Serial.print(F("\r\nOK\r\n"));
+}
+#endif
+
+//---------------------------------------------------
+// Show the latest measurements, or the summary
+// table when a session has just ended
+//---------------------------------------------------
+void show_values()
+{
+#if USE_OLED
+  oled_show_values(shutter_speed_1_ms,
+                   shutter_speed_2_ms,
+                   shutter_speed_3_ms,
+                   fractional_shutter_speed_1,
+                   fractional_shutter_speed_2,
+                   fractional_shutter_speed_3,
+                   curtain_1_travel_time_ms,
+                   curtain_2_travel_time_ms);
+#endif
+
+#if USE_TFT
+#if USE_SERIAL_COMMANDS
+  if (show_session_table)
+  {
+    session_row_t row;
+    tft_show_session_header();
+    for (uint8_t i = 0; session_row(i, &row); i++)
+    {
+      tft_show_session_row(i, &row);
+    }
+    show_session_table = false;
+    return;
+  }
+#endif
+  tft_show_values(shutter_speed_1_ms,
+                  shutter_speed_2_ms,
+                  shutter_speed_3_ms,
+                  fractional_shutter_speed_1,
+                  fractional_shutter_speed_2,
+                  fractional_shutter_speed_3,
+                  curtain_1_travel_time_ms,
+                  curtain_2_travel_time_ms);
+#endif
+}
+
 //---------------------------------------------------
 // Setup function, called once at start
 //---------------------------------------------------
 void setup()
 {
-#if DEBUG
   Serial.begin(115200);
   Serial.flush();
-#endif
 
   pinMode(LASER_RECEIVER_1_INPUT, INPUT);
   pinMode(LASER_RECEIVER_2_INPUT, INPUT);
@@ -131,6 +800,16 @@ void setup()
   pinMode(LASER_DIODE_2_OUTPUT, OUTPUT);
   pinMode(LASER_DIODE_3_OUTPUT, OUTPUT);
 
+#if USE_SERIAL_COMMANDS
+  laser_port = portOutputRegister(digitalPinToPort(LASER_DIODE_1_OUTPUT));
+  laser_masks[0] = digitalPinToBitMask(LASER_DIODE_1_OUTPUT);
+  laser_masks[1] = digitalPinToBitMask(LASER_DIODE_2_OUTPUT);
+  laser_masks[2] = digitalPinToBitMask(LASER_DIODE_3_OUTPUT);
+  laser_mask = laser_masks[0] | laser_masks[1] | laser_masks[2];
+#endif
+
+  calibration_load();
+
 #if USE_OLED
 #if DEBUG
   Serial.println("Setup OLED");
@@ -149,6 +828,9 @@ void setup()
 #if DEBUG
   Serial.println("Installing interrupt handlers");
 #endif
+  edge_filter_reset(&detectors[0], digitalRead(LASER_RECEIVER_1_INPUT) == LOW);
+  edge_filter_reset(&detectors[1], digitalRead(LASER_RECEIVER_2_INPUT) == LOW);
+  edge_filter_reset(&detectors[2], digitalRead(LASER_RECEIVER_3_INPUT) == LOW);
   attachPCINT(digitalPinToPCINT(LASER_RECEIVER_1_INPUT), detector1, CHANGE);
   attachPCINT(digitalPinToPCINT(LASER_RECEIVER_2_INPUT), detector2, CHANGE);
   attachPCINT(digitalPinToPCINT(LASER_RECEIVER_3_INPUT), detector3, CHANGE);
@@ -156,9 +838,11 @@ void setup()
 #if DEBUG
   Serial.println("Ready... turning on lasers!");
 #endif
-  digitalWrite(LASER_DIODE_1_OUTPUT, HIGH);
-  digitalWrite(LASER_DIODE_2_OUTPUT, HIGH);
-  digitalWrite(LASER_DIODE_3_OUTPUT, HIGH);
+  set_armed(true);
+
+#if USE_SERIAL_COMMANDS
+  commands_setup(commands, COMMAND_COUNT);
+#endif
 }
 
 //---------------------------------------------------
@@ -166,6 +850,46 @@ void setup()
 //---------------------------------------------------
 void loop()
 {
+  uint32_t loop_start_us = micros();
+
+#if USE_SERIAL_COMMANDS
+  commands_poll();
+
+  // keep count of micros() wrapping round
+  noInterrupts();
+  timebase_update(micros());
+  interrupts();
+#else
+  poll_memory_report();
+#endif
+
+  bool measuring = armed && (millis() - armed_at_ms) >= ARM_SETTLE_MS;
+
+#if USE_SERIAL_COMMANDS
+  if (mode == MODE_CALIBRATE)
+  {
+    run_calibration();
+  }
+  else if (mode == MODE_LONG)
+  {
+    run_long_exposure(measuring);
+  }
+#endif
+
+  // throw away anything seen while disarmed, settling or calibrating,
+  // long exposures only use the centre sensor
+  if (!measuring || mode == MODE_CALIBRATE || mode == MODE_LONG)
+  {
+    for (uint8_t i = 0; i < DETECTORS; i++)
+    {
+      if (i != 1 || mode != MODE_LONG)
+      {
+        detectors[i].speed_measured = false;
+      }
+      detectors[i].curtain_measured = false;
+    }
+  }
+
   // --------- calculate ---------
 
   // Calculate shutter speeds independently so that a single sensor can
@@ -212,18 +936,23 @@ void loop()
   //   Curtain 2 travel time = t_3_delta
   //   Shutter speed = t_2_delta
   //
-  if (speed_1_measured)
+  uint32_t start_us;
+  uint32_t end_us;
+  if (take_speed(0, &start_us, &end_us))
   {
-    speed_1_measured = false;
     display_update_counter = 0;
-    double shutter_speed_us = (double)(ts_1_end_us - ts_1_start_us);
+    uint32_t shutter_time_us = end_us - start_us;
+#if USE_SERIAL_COMMANDS
+    stats_add_speed(0, start_us, shutter_time_us);
+#endif
+    double shutter_speed_us = (double)shutter_time_us;
     shutter_speed_1_ms = shutter_speed_us / 1000.0;
     fractional_shutter_speed_1 = 1000000.0 / shutter_speed_us;
 #if DEBUG
     Serial.print("t1_s=");
-    Serial.print(ts_1_start_us);
+    Serial.print(start_us);
     Serial.print("us   t1_e=");
-    Serial.print(ts_1_end_us);
+    Serial.print(end_us);
     Serial.println("us");
     Serial.print("Speed 1 = ");
     Serial.print(shutter_speed_1_ms, 1);
@@ -232,18 +961,30 @@ void loop()
     Serial.println(fractional_shutter_speed_1, 1);
 #endif
   }
-  if (speed_2_measured)
+  if (mode != MODE_LONG && take_speed(1, &start_us, &end_us))
   {
-    speed_2_measured = false;
     display_update_counter = 0;
-    double shutter_speed_us = (double)(ts_2_end_us - ts_2_start_us);
+    uint32_t shutter_time_us = end_us - start_us;
+#if USE_SERIAL_COMMANDS
+    stats_add_speed(1, start_us, shutter_time_us);
+    if (mode == MODE_SESSION)
+    {
+      session_row_t row;
+      int8_t closed = session_add_speed(shutter_time_us);
+      if (closed >= 0 && session_setting_row(closed, &row))
+      {
+        print_session_row("!", &row);
+      }
+    }
+#endif
+    double shutter_speed_us = (double)shutter_time_us;
     shutter_speed_2_ms = shutter_speed_us / 1000.0;
     fractional_shutter_speed_2 = 1000000.0 / shutter_speed_us;
 #if DEBUG
     Serial.print("t2_s=");
-    Serial.print(ts_2_start_us);
+    Serial.print(start_us);
     Serial.print("us   t2_e=");
-    Serial.print(ts_2_end_us);
+    Serial.print(end_us);
     Serial.println("us");
     Serial.print("Speed 2 = ");
     Serial.print(shutter_speed_2_ms, 1);
@@ -253,18 +994,21 @@ void loop()
     Serial.println("");
 #endif
   }
-  if (speed_3_measured)
+  if (take_speed(2, &start_us, &end_us))
   {
-    speed_3_measured = false;
     display_update_counter = 0;
-    double shutter_speed_us = (double)(ts_3_end_us - ts_3_start_us);
+    uint32_t shutter_time_us = end_us - start_us;
+#if USE_SERIAL_COMMANDS
+    stats_add_speed(2, start_us, shutter_time_us);
+#endif
+    double shutter_speed_us = (double)shutter_time_us;
     shutter_speed_3_ms = shutter_speed_us / 1000.0;
     fractional_shutter_speed_3 = 1000000.0 / shutter_speed_us;
 #if DEBUG
     Serial.print("t3_s=");
-    Serial.print(ts_3_start_us);
+    Serial.print(start_us);
     Serial.print("us   t3_e=");
-    Serial.print(ts_3_end_us);
+    Serial.print(end_us);
     Serial.println("us");
     Serial.print("Speed 3 = ");
     Serial.print(shutter_speed_3_ms, 1);
@@ -274,29 +1018,21 @@ void loop()
     Serial.println("");
 #endif
   }
-  if (curtain_1_measured && curtain_2_measured)
+  uint32_t curtain_1_travel_time_us;
+  uint32_t curtain_2_travel_time_us;
+  if (take_curtains(&curtain_1_travel_time_us, &curtain_2_travel_time_us))
   {
-    curtain_1_measured = false;
-    curtain_2_measured = false;
     display_update_counter = 0;
-    // check which is bigger and calculate accordingly
-    // so that travel direction does not matter
-    if (ts_3_start_us > ts_1_start_us)
-    {
-      curtain_1_travel_time_ms = (double)(ts_3_start_us - ts_1_start_us) / 1000.0;
-    }
-    else
-    {
-      curtain_1_travel_time_ms = (double)(ts_1_start_us - ts_3_start_us) / 1000.0;
-    }
-    if (ts_3_end_us > ts_1_end_us)
-    {
-      curtain_2_travel_time_ms = (double)(ts_3_end_us - ts_1_end_us) / 1000.0;
-    }
-    else
+
+#if USE_SERIAL_COMMANDS
+    stats_add_curtains(curtain_1_travel_time_us, curtain_2_travel_time_us);
+    if (mode == MODE_SESSION)
     {
-      curtain_2_travel_time_ms = (double)(ts_1_end_us - ts_3_end_us) / 1000.0;
+      session_add_curtains(curtain_1_travel_time_us, curtain_2_travel_time_us);
     }
+#endif
+    curtain_1_travel_time_ms = (double)curtain_1_travel_time_us / 1000.0;
+    curtain_2_travel_time_ms = (double)curtain_2_travel_time_us / 1000.0;
 
 #if DEBUG
     Serial.print("Curtain 1 travel time=");
@@ -314,30 +1050,31 @@ void loop()
   // --------- display ---------
   if (display_update_counter == DISPLAY_UPDATE_TRIGGER)
   {
-#if USE_OLED
-    oled_show_values(shutter_speed_1_ms,
-                     shutter_speed_2_ms,
-                     shutter_speed_3_ms,
-                     fractional_shutter_speed_1,
-                     fractional_shutter_speed_2,
-                     fractional_shutter_speed_3,
-                     curtain_1_travel_time_ms,
-                     curtain_2_travel_time_ms);
-#endif
-
-#if USE_TFT
-    tft_show_values(shutter_speed_1_ms,
-                    shutter_speed_2_ms,
-                    shutter_speed_3_ms,
-                    fractional_shutter_speed_1,
-                    fractional_shutter_speed_2,
-                    fractional_shutter_speed_3,
-                    curtain_1_travel_time_ms,
-                    curtain_2_travel_time_ms);
+    uint32_t display_start_us = micros();
+#if USE_SERIAL_COMMANDS
+    if (mode == MODE_LONG)
+    {
+      show_long_exposure();
+    }
+    else
 #endif
+    {
+      show_values();
+    }
+    display_update_us = micros() - display_start_us;
+    if (display_update_us > display_update_max_us)
+    {
+      display_update_max_us = display_update_us;
+    }
   }
   if (display_update_counter <= DISPLAY_UPDATE_TRIGGER)
   {
     display_update_counter++;
   }
+
+  uint32_t loop_us = micros() - loop_start_us;
+  if (loop_us > loop_max_us)
+  {
+    loop_max_us = loop_us;
+  }
 }
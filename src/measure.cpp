@@ -0,0 +1,56 @@
+#include "measure.h"
+#include "calibration.h"
+
+//---------------------------------------------------
+// Take a shutter time from a detector once its last
+// edge has settled, with the calibration applied
+//---------------------------------------------------
+bool measure_take_speed(volatile edge_channel_t *channels, uint8_t detector, uint32_t now_us,
+                        uint32_t *start_us, uint32_t *end_us)
+{
+  volatile edge_channel_t *channel = &channels[detector];
+  if (!channel->speed_measured || !edge_filter_settled(channel, now_us))
+  {
+    return false;
+  }
+  channel->speed_measured = false;
+  *start_us = calibration_start_us(detector, channel->start_us);
+  *end_us = calibration_end_us(detector, channel->end_us);
+  return true;
+}
+
+//---------------------------------------------------
+// Take the curtain travel times from the outer
+// detectors once both have seen a whole exposure
+//---------------------------------------------------
+bool measure_take_curtains(volatile edge_channel_t *channels, uint32_t now_us,
+                           uint32_t *curtain_1_us, uint32_t *curtain_2_us)
+{
+  volatile edge_channel_t *channel_1 = &channels[0];
+  volatile edge_channel_t *channel_3 = &channels[2];
+  if (!channel_1->curtain_measured || !edge_filter_settled(channel_1, now_us) ||
+      !channel_3->curtain_measured || !edge_filter_settled(channel_3, now_us))
+  {
+    return false;
+  }
+  channel_1->curtain_measured = false;
+  channel_3->curtain_measured = false;
+  *curtain_1_us = measure_travel_us(calibration_start_us(0, channel_1->curtain_start_us),
+                                    calibration_start_us(2, channel_3->curtain_start_us));
+  *curtain_2_us = measure_travel_us(calibration_end_us(0, channel_1->curtain_end_us),
+                                    calibration_end_us(2, channel_3->curtain_end_us));
+  return true;
+}
+
+//---------------------------------------------------
+// Time between the edges at the two outer detectors,
+// whichever the curtain reached first, so the travel
+// direction does not matter. The difference is signed
+// so it is right even when micros() wraps round
+// between the two detectors.
+//---------------------------------------------------
+uint32_t measure_travel_us(uint32_t first_us, uint32_t last_us)
+{
+  int32_t delta_us = last_us - first_us;
+  return delta_us > 0 ? delta_us : -delta_us;
+}
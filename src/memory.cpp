@@ -0,0 +1,80 @@
+#include <avr/io.h>
+
+#include "memory.h"
+
+#define STACK_PAINT 0xC5
+
+// symbols provided by the linker and malloc
+extern uint8_t __data_start;
+extern uint8_t _end;
+extern uint8_t __heap_start;
+extern char *__brkval;
+
+//---------------------------------------------------
+// Paint the unused RAM. This runs from .init1,
+// before the stack pointer and r1 are set up, so it
+// must be written in assembler and use no stack.
+//---------------------------------------------------
+void memory_paint(void) __attribute__((naked, used, section(".init1")));
+
+void memory_paint(void)
+{
+  __asm volatile("    ldi r30,lo8(_end)\n"
+                 "    ldi r31,hi8(_end)\n"
+                 "    ldi r24,lo8(%0)\n"
+                 "    ldi r25,hi8(__stack)\n"
+                 "    rjmp 2f\n"
+                 "1:\n"
+                 "    st Z+,r24\n"
+                 "2:\n"
+                 "    cpi r30,lo8(__stack)\n"
+                 "    cpc r31,r25\n"
+                 "    brlo 1b\n"
+                 "    breq 1b\n"
+                 :
+                 : "i"(STACK_PAINT));
+}
+
+//---------------------------------------------------
+// The top of the heap, where free RAM starts
+//---------------------------------------------------
+static const uint8_t *heap_end()
+{
+  return __brkval ? (const uint8_t *)__brkval : &__heap_start;
+}
+
+//---------------------------------------------------
+// The lowest address the stack has reached
+//---------------------------------------------------
+static const uint8_t *stack_low_water()
+{
+  const uint8_t *p = heap_end();
+  while (p <= (const uint8_t *)RAMEND && *p == STACK_PAINT)
+  {
+    p++;
+  }
+  return p;
+}
+
+// .data and .bss
+uint16_t memory_static_bytes()
+{
+  return &_end - &__data_start;
+}
+
+// allocated with malloc, e.g. the SSD1306 frame buffer
+uint16_t memory_heap_bytes()
+{
+  return heap_end() - &__heap_start;
+}
+
+uint16_t memory_stack_peak_bytes()
+{
+  return (const uint8_t *)RAMEND + 1 - stack_low_water();
+}
+
+// the closest the stack has come to the heap
+uint16_t memory_min_free_bytes()
+{
+  return stack_low_water() - heap_end();
+}
@@ -66,15 +66,15 @@ void oled_setup()
 
   oled_display.setTextSize(READY_TEXT_SIZE);
   oled_display.setCursor(READY_TEXT_SIZE * BASE_TEXT_WIDTH_px, (SCREEN_HEIGHT_px - BASE_TEXT_HEIGHT_px * (READY_TEXT_SIZE + VERSION_TEXT_SIZE)) / 2);
-  oled_display.print("Ready");
+  oled_display.print(F("Ready"));
 
   oled_display.setTextSize(VERSION_TEXT_SIZE);
   oled_display.setCursor(0, SCREEN_HEIGHT_px - VERSION_TEXT_SIZE * BASE_TEXT_HEIGHT_px);
-  oled_display.print("v");
+  oled_display.print('v');
   oled_display.print(VERSION_MAJOR);
-  oled_display.print(".");
+  oled_display.print('.');
   oled_display.print(VERSION_MINOR);
-  oled_display.print(".");
+  oled_display.print('.');
   oled_display.print(VERSION_REV);
 
   oled_display.display();
@@ -101,31 +101,73 @@ void oled_show_values(double shutter_speed_1_ms,
 
   oled_display.setCursor(0, 0);
   oled_display.print(shutter_speed_2_ms, 1);
-  oled_display.print("ms");
+  oled_display.print(F("ms"));
 
   oled_display.setCursor(0, SPEED_TEXT_SIZE * BASE_TEXT_HEIGHT_px + GAP_PIXELS);
-  oled_display.print("1/");
+  oled_display.print(F("1/"));
   oled_display.print(fractional_shutter_speed_2, 1);
 
   oled_display.setTextSize(TRAVEL_TEXT_SIZE);
 
   oled_display.setCursor(0, SCREEN_HEIGHT_px - 2 * TRAVEL_TEXT_SIZE * BASE_TEXT_HEIGHT_px - GAP_PIXELS);
-  oled_display.print("c1:");
+  oled_display.print(F("c1:"));
   oled_display.print(curtain_1_travel_time_ms, 1);
-  oled_display.print("ms");
+  oled_display.print(F("ms"));
 
   oled_display.setCursor(SCREEN_WIDTH_px * 2 / 3, SCREEN_HEIGHT_px - 2 * TRAVEL_TEXT_SIZE * BASE_TEXT_HEIGHT_px - GAP_PIXELS);
-  oled_display.print("1/");
+  oled_display.print(F("1/"));
   oled_display.print(fractional_shutter_speed_1, 1);
 
   oled_display.setCursor(0, SCREEN_HEIGHT_px - TRAVEL_TEXT_SIZE * BASE_TEXT_HEIGHT_px);
-  oled_display.print("c2:");
+  oled_display.print(F("c2:"));
   oled_display.print(curtain_2_travel_time_ms, 1);
-  oled_display.print("ms");
+  oled_display.print(F("ms"));
 
   oled_display.setCursor(SCREEN_WIDTH_px * 2 / 3, SCREEN_HEIGHT_px - TRAVEL_TEXT_SIZE * BASE_TEXT_HEIGHT_px);
-  oled_display.print("1/");
+  oled_display.print(F("1/"));
   oled_display.print(fractional_shutter_speed_3, 1);
 
+  oled_display.display();
+}
+
+//---------------------------------------------------
+// Show the time of a long exposure, in tenths of
+// a second while it is running, then to the ms
+//---------------------------------------------------
+void oled_show_elapsed(uint32_t seconds, uint32_t fraction_us, bool open)
+{
+  const int ELAPSED_TEXT_SIZE = 2;
+  const int STATUS_TEXT_SIZE = 1;
+
+  oled_display.clearDisplay();
+
+  oled_display.setTextSize(ELAPSED_TEXT_SIZE);
+  oled_display.setCursor(0, 0);
+  oled_display.print(seconds);
+  oled_display.print('.');
+  if (open)
+  {
+    oled_display.print(fraction_us / 100000);
+  }
+  else
+  {
+    // leading zeros for the milliseconds
+    uint32_t ms = fraction_us / 1000;
+    if (ms < 100)
+    {
+      oled_display.print('0');
+    }
+    if (ms < 10)
+    {
+      oled_display.print('0');
+    }
+    oled_display.print(ms);
+  }
+  oled_display.print('s');
+
+  oled_display.setTextSize(STATUS_TEXT_SIZE);
+  oled_display.setCursor(0, SCREEN_HEIGHT_px - STATUS_TEXT_SIZE * BASE_TEXT_HEIGHT_px);
+  oled_display.print(open ? F("Shutter open") : F("Shutter closed"));
+
   oled_display.display();
 }
\ No newline at end of file
@@ -0,0 +1,208 @@
+#ifdef ARDUINO
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+#define pgm_read_word(address) (*(address))
+#define pgm_read_dword(address) (*(address))
+#endif
+#include <math.h>
+#include <string.h>
+
+#include "session.h"
+
+// standard speeds on the dial, slowest first, in PROGMEM
+static const uint16_t denominators[SESSION_SETTINGS] PROGMEM = {
+    1, 2, 4, 8, 15, 30, 60, 125, 250, 500, 1000, 2000, 4000, 8000};
+
+#define DENOMINATOR(setting) pgm_read_word(&denominators[setting])
+
+// the boundary between each setting and the next faster one in us,
+// 1,000,000 / sqrt(denominator * next denominator), which is half way
+// between them in stops even where the step is not a whole stop
+static const uint32_t boundaries_us[SESSION_SETTINGS - 1] PROGMEM = {
+    707107, 353553, 176777, 91287, 47140, 23570, 11547, 5657, 2828, 1414, 707, 354, 177};
+
+typedef struct
+{
+  uint8_t count;
+  uint8_t curtain_count;
+  uint32_t sum_us;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint32_t curtain_1_sum_us;
+  uint32_t curtain_2_sum_us;
+} session_group_t;
+
+static session_group_t groups[SESSION_SETTINGS];
+
+// the setting of the group shots are going into, -1 before the first shot
+static int8_t current = -1;
+
+// the setting declared for the shots, -1 to use the nearest one
+static int8_t declared = -1;
+
+//---------------------------------------------------
+// Find the nearest standard speed in stops
+//---------------------------------------------------
+static uint8_t nearest_setting(uint32_t shutter_us)
+{
+  for (uint8_t i = 0; i < SESSION_SETTINGS - 1; i++)
+  {
+    if (shutter_us >= pgm_read_dword(&boundaries_us[i]))
+    {
+      return i;
+    }
+  }
+  return SESSION_SETTINGS - 1;
+}
+
+//---------------------------------------------------
+// Start a new session with an empty table
+//---------------------------------------------------
+void session_begin()
+{
+  memset(groups, 0, sizeof(groups));
+  current = -1;
+  declared = -1;
+}
+
+//---------------------------------------------------
+// Put the following shots in the group for 1/denominator
+// seconds, or in the nearest group when denominator is 0.
+// Returns false if it is not a standard speed.
+//---------------------------------------------------
+bool session_declare(uint16_t denominator)
+{
+  if (denominator == 0)
+  {
+    declared = -1;
+    return true;
+  }
+  for (uint8_t i = 0; i < SESSION_SETTINGS; i++)
+  {
+    if (DENOMINATOR(i) == denominator)
+    {
+      declared = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+//---------------------------------------------------
+// The declared speed's denominator, 0 if none
+//---------------------------------------------------
+uint16_t session_declared()
+{
+  return declared < 0 ? 0 : DENOMINATOR(declared);
+}
+
+//---------------------------------------------------
+// Add a shot. Returns the setting of the group that
+// was closed because the dial moved, or -1.
+//---------------------------------------------------
+int8_t session_add_speed(uint32_t shutter_us)
+{
+  int8_t setting = declared < 0 ? nearest_setting(shutter_us) : declared;
+  int8_t closed = (setting != current) ? current : -1;
+  session_group_t *group = &groups[setting];
+
+  current = setting;
+  if (group->count == UINT8_MAX)
+  {
+    return closed;
+  }
+  if (group->count == 0 || shutter_us < group->min_us)
+  {
+    group->min_us = shutter_us;
+  }
+  if (group->count == 0 || shutter_us > group->max_us)
+  {
+    group->max_us = shutter_us;
+  }
+  group->sum_us += shutter_us;
+  group->count++;
+  return closed;
+}
+
+//---------------------------------------------------
+// Add the curtain travel times of the latest shot
+//---------------------------------------------------
+void session_add_curtains(uint32_t curtain_1_us, uint32_t curtain_2_us)
+{
+  if (current < 0 || groups[current].curtain_count == UINT8_MAX)
+  {
+    return;
+  }
+  groups[current].curtain_1_sum_us += curtain_1_us;
+  groups[current].curtain_2_sum_us += curtain_2_us;
+  groups[current].curtain_count++;
+}
+
+//---------------------------------------------------
+// Close the last group, returns its setting or -1
+//---------------------------------------------------
+int8_t session_end()
+{
+  int8_t closed = current;
+  current = -1;
+  return closed;
+}
+
+//---------------------------------------------------
+// Number of settings that have had any shots
+//---------------------------------------------------
+uint8_t session_row_count()
+{
+  uint8_t rows = 0;
+  for (uint8_t i = 0; i < SESSION_SETTINGS; i++)
+  {
+    if (groups[i].count)
+    {
+      rows++;
+    }
+  }
+  return rows;
+}
+
+//---------------------------------------------------
+// Summary of a setting, false if it has no shots
+//---------------------------------------------------
+bool session_setting_row(uint8_t setting, session_row_t *row)
+{
+  if (setting >= SESSION_SETTINGS || groups[setting].count == 0)
+  {
+    return false;
+  }
+
+  const session_group_t *group = &groups[setting];
+  row->denominator = DENOMINATOR(setting);
+  row->count = group->count;
+  row->mean_us = (group->sum_us + group->count / 2) / group->count;
+  row->ev_error = log(row->mean_us * (double)DENOMINATOR(setting) / 1000000.0) / log(2.0);
+  row->spread_us = group->max_us - group->min_us;
+  row->curtain_1_us = 0;
+  row->curtain_2_us = 0;
+  if (group->curtain_count)
+  {
+    row->curtain_1_us = group->curtain_1_sum_us / group->curtain_count;
+    row->curtain_2_us = group->curtain_2_sum_us / group->curtain_count;
+  }
+  return true;
+}
+
+//---------------------------------------------------
+// Summary rows in dial order, slowest first,
+// skipping settings without any shots
+//---------------------------------------------------
+bool session_row(uint8_t index, session_row_t *row)
+{
+  for (uint8_t i = 0; i < SESSION_SETTINGS; i++)
+  {
+    if (groups[i].count && index-- == 0)
+    {
+      return session_setting_row(i, row);
+    }
+  }
+  return false;
+}
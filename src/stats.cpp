@@ -0,0 +1,99 @@
+#include <string.h>
+
+#include "stats.h"
+
+static stats_accumulator_t speeds[STATS_CHANNELS];
+static stats_accumulator_t curtains[2];
+
+// the log is a ring buffer, log_next is where the next entry goes
+static stats_log_entry_t log_entries[STATS_LOG_SIZE];
+static uint8_t log_next = 0;
+static uint8_t log_count = 0;
+
+//---------------------------------------------------
+// Add one value to an accumulator
+//---------------------------------------------------
+static void accumulate(stats_accumulator_t *acc, uint32_t value_us)
+{
+  if (acc->count == 0 || value_us < acc->min_us)
+  {
+    acc->min_us = value_us;
+  }
+  if (acc->count == 0 || value_us > acc->max_us)
+  {
+    acc->max_us = value_us;
+  }
+  acc->sum_us += value_us;
+  if (acc->count < UINT16_MAX)
+  {
+    acc->count++;
+  }
+}
+
+//---------------------------------------------------
+// Add an entry to the log, overwriting the oldest
+//---------------------------------------------------
+static void log_add(uint8_t kind, uint32_t a_us, uint32_t b_us)
+{
+  log_entries[log_next].kind = kind;
+  log_entries[log_next].a_us = a_us;
+  log_entries[log_next].b_us = b_us;
+  log_next = (log_next + 1) % STATS_LOG_SIZE;
+  if (log_count < STATS_LOG_SIZE)
+  {
+    log_count++;
+  }
+}
+
+//---------------------------------------------------
+// Clear all accumulators and the log
+//---------------------------------------------------
+void stats_reset()
+{
+  memset(speeds, 0, sizeof(speeds));
+  memset(curtains, 0, sizeof(curtains));
+  log_next = 0;
+  log_count = 0;
+}
+
+void stats_add_speed(uint8_t channel, uint32_t start_us, uint32_t shutter_us)
+{
+  if (channel >= STATS_CHANNELS)
+  {
+    return;
+  }
+  accumulate(&speeds[channel], shutter_us);
+  log_add(STATS_LOG_SPEED_1 + channel, shutter_us, start_us);
+}
+
+void stats_add_curtains(uint32_t curtain_1_us, uint32_t curtain_2_us)
+{
+  accumulate(&curtains[0], curtain_1_us);
+  accumulate(&curtains[1], curtain_2_us);
+  log_add(STATS_LOG_CURTAIN, curtain_1_us, curtain_2_us);
+}
+
+const stats_accumulator_t *stats_speed(uint8_t channel)
+{
+  return &speeds[channel];
+}
+
+const stats_accumulator_t *stats_curtain(uint8_t curtain)
+{
+  return &curtains[curtain];
+}
+
+uint8_t stats_log_count()
+{
+  return log_count;
+}
+
+//---------------------------------------------------
+// Log entries are indexed from the oldest (0)
+// to the newest (stats_log_count() - 1)
+//---------------------------------------------------
+const stats_log_entry_t *stats_log_entry(uint8_t index)
+{
+  uint8_t oldest = (log_next + STATS_LOG_SIZE - log_count) % STATS_LOG_SIZE;
+  return &log_entries[(oldest + index) % STATS_LOG_SIZE];
+}
@@ -109,20 +109,46 @@
 Adafruit_ILI9341 tft = Adafruit_ILI9341(TFT_CS, TFT_DC, TFT_RST); // ILI9341 driver with hardware SPI using the default SPI peripheral
 //Adafruit_ILI9341 tft = Adafruit_ILI9341(TFT_CS, TFT_DC, TFT_MOSI, TFT_SCLK, TFT_RST, TFT_MISO); // ILI9341 driver with Software SPI
 
+// Session summary table, one line per shutter speed setting. The rows
+// are closer together than the heading so all of them fit inside the
+// border.
+#define TABLE_TEXT_SIZE          1
+#define TABLE_LINE_HEIGHT        (TABLE_TEXT_SIZE*BASE_TEXT_HEIGHT_px+LINE_SPACE)
+#define TABLE_ROW_HEIGHT         (TABLE_TEXT_SIZE*BASE_TEXT_HEIGHT_px+LINE_SPACE/2)
+#define TABLE_TITLE_Y            (LINE_SPACE)
+#define TABLE_HEADING_Y          (TABLE_TITLE_Y+HEADING_TEXT_SIZE*BASE_TEXT_HEIGHT_px+LINE_SPACE*2)
+#define TABLE_FIRST_ROW_Y        (TABLE_HEADING_Y+TABLE_LINE_HEIGHT+LINE_SPACE)
+#if TABLE_FIRST_ROW_Y+SESSION_SETTINGS*TABLE_ROW_HEIGHT > SCREEN_HEIGHT_px-LINE_SPACE
+#error "The session table does not fit on the screen"
+#endif
+#define TABLE_COLUMNS            7
+const int16_t table_column_x[TABLE_COLUMNS] = {8, 56, 86, 146, 192, 244, 284};
+
+// Long exposure screen, elapsed time in the middle with a status line below
+#define ELAPSED_TEXT_SIZE        5
+#define ELAPSED_Y                ((SCREEN_HEIGHT_px-ELAPSED_TEXT_SIZE*BASE_TEXT_HEIGHT_px)/2)
+#define ELAPSED_STATUS_Y         (ELAPSED_Y+ELAPSED_TEXT_SIZE*BASE_TEXT_HEIGHT_px+LINE_SPACE*3)
+
+// what is on the screen, anything but the normal layout
+// has to be cleared before the normal values are shown
+enum tft_screen_t
+{
+  SCREEN_VALUES,
+  SCREEN_TABLE,
+  SCREEN_ELAPSED
+};
+static tft_screen_t screen = SCREEN_VALUES;
+
 //---------------------------------------------------
-// Helper function called once at startup to 
-// setup the display (for example draw borders)
+// Draw the fixed parts of the normal layout
 //---------------------------------------------------
-void tft_setup()
+static void draw_layout()
 {
   char buffer[35];
   int16_t ulx,uly;
   uint16_t w,h;
 
-  tft.begin();
   tft.fillScreen(BACKGROUND_COLOUR);
-
-  tft.setRotation(1);
     
   // Print small app name and version at the top
   tft.setTextColor(TEXT_COLOUR);  
@@ -177,6 +203,17 @@ void tft_setup()
   
 }
 
+//---------------------------------------------------
+// Helper function called once at startup to 
+// setup the display (for example draw borders)
+//---------------------------------------------------
+void tft_setup()
+{
+  tft.begin();
+  tft.setRotation(1);
+  draw_layout();
+}
+
 //---------------------------------------------------
 // Print values to the screen.
 //---------------------------------------------------
@@ -194,6 +231,13 @@ void tft_show_values( double shutter_speed_1_ms,
   int16_t ulx,uly;
   uint16_t w1, h, w2;
 
+  // Put the normal layout back after the session table or long exposure
+  if (screen != SCREEN_VALUES)
+  {
+    draw_layout();
+    screen = SCREEN_VALUES;
+  }
+
   // Clear previous shutter speeds and times
   tft.fillRect(1, SPEED_DENOMINATOR_Y, SCREEN_WIDTH_px-2, TRAVEL_TIME_HEADING_TOP-SPEED_DENOMINATOR_Y-2, BACKGROUND_COLOUR);
   
@@ -248,6 +292,140 @@ void tft_show_values( double shutter_speed_1_ms,
   tft.print(buffer2);
 }
 
+// column headings of the session summary table
+static const char heading_speed[] PROGMEM = "Speed";
+static const char heading_count[] PROGMEM = "N";
+static const char heading_mean[] PROGMEM = "Mean ms";
+static const char heading_ev[] PROGMEM = "EV";
+static const char heading_spread[] PROGMEM = "Spread";
+static const char heading_curtain_1[] PROGMEM = "C1 ms";
+static const char heading_curtain_2[] PROGMEM = "C2 ms";
+static const char *const headings[TABLE_COLUMNS] PROGMEM = {heading_speed, heading_count, heading_mean, heading_ev, heading_spread, heading_curtain_1, heading_curtain_2};
+
+//---------------------------------------------------
+// Clear the screen and draw the title and column
+// headings of the session summary table
+//---------------------------------------------------
+void tft_show_session_header()
+{
+  int16_t ulx,uly;
+  uint16_t w,h;
+
+  screen = SCREEN_TABLE;
+  tft.fillScreen(BACKGROUND_COLOUR);
+
+  tft.setTextColor(TEXT_COLOUR);
+  tft.setTextSize(HEADING_TEXT_SIZE);
+  tft.getTextBounds(F("Session Summary"),0,0,&ulx,&uly,&w,&h);
+  tft.setCursor(SCREEN_WIDTH_px/2 - w/2, TABLE_TITLE_Y);
+  tft.print(F("Session Summary"));
+
+  tft.fillRect(0, TABLE_HEADING_Y - LINE_SPACE/2, SCREEN_WIDTH_px, TABLE_LINE_HEIGHT, HEADING_COLOUR);
+  tft.setTextSize(TABLE_TEXT_SIZE);
+  for (uint8_t i = 0; i < TABLE_COLUMNS; i++)
+  {
+    tft.setCursor(table_column_x[i], TABLE_HEADING_Y);
+    tft.print((const __FlashStringHelper *)pgm_read_ptr(&headings[i]));
+  }
+
+  tft.drawRect(0, 0, SCREEN_WIDTH_px, SCREEN_HEIGHT_px, BORDER_COLOUR);
+}
+
+//---------------------------------------------------
+// Print one line of the session summary table
+//---------------------------------------------------
+void tft_show_session_row(uint8_t line, const session_row_t *row)
+{
+  char buffer[12];
+  int16_t y = TABLE_FIRST_ROW_Y + line * TABLE_ROW_HEIGHT;
+
+  tft.setTextColor(TEXT_COLOUR, BACKGROUND_COLOUR);
+  tft.setTextSize(TABLE_TEXT_SIZE);
+
+  if (row->denominator == 1)
+  {
+    snprintf_P(buffer, sizeof(buffer), PSTR("1s"));
+  }
+  else
+  {
+    snprintf_P(buffer, sizeof(buffer), PSTR("1/%u"), row->denominator);
+  }
+  tft.setCursor(table_column_x[0], y);
+  tft.print(buffer);
+
+  snprintf_P(buffer, sizeof(buffer), PSTR("%u"), row->count);
+  tft.setCursor(table_column_x[1], y);
+  tft.print(buffer);
+
+  snprintf_P(buffer, sizeof(buffer), PSTR("%0.2f"), row->mean_us / 1000.0);
+  tft.setCursor(table_column_x[2], y);
+  tft.print(buffer);
+
+  snprintf_P(buffer, sizeof(buffer), PSTR("%+0.2f"), row->ev_error);
+  tft.setCursor(table_column_x[3], y);
+  tft.print(buffer);
+
+  snprintf_P(buffer, sizeof(buffer), PSTR("%0.2f"), row->spread_us / 1000.0);
+  tft.setCursor(table_column_x[4], y);
+  tft.print(buffer);
+
+  snprintf_P(buffer, sizeof(buffer), PSTR("%0.1f"), row->curtain_1_us / 1000.0);
+  tft.setCursor(table_column_x[5], y);
+  tft.print(buffer);
+
+  snprintf_P(buffer, sizeof(buffer), PSTR("%0.1f"), row->curtain_2_us / 1000.0);
+  tft.setCursor(table_column_x[6], y);
+  tft.print(buffer);
+}
+
+//---------------------------------------------------
+// Show the time of a long exposure, in tenths of
+// a second while it is running, then to the ms
+//---------------------------------------------------
+void tft_show_elapsed(uint32_t seconds, uint32_t fraction_us, bool open)
+{
+  char buffer[16];
+  int16_t ulx,uly;
+  uint16_t w,h;
+
+  if (screen != SCREEN_ELAPSED)
+  {
+    screen = SCREEN_ELAPSED;
+    tft.fillScreen(BACKGROUND_COLOUR);
+    tft.fillRect(SHUTTER_SPEED_HEADING_LEFT, SHUTTER_SPEED_HEADING_TOP, (SHUTTER_SPEED_HEADING_RIGHT-SHUTTER_SPEED_HEADING_LEFT), (SHUTTER_SPEED_HEADING_BOTTOM-SHUTTER_SPEED_HEADING_TOP), HEADING_COLOUR);
+    tft.drawRect(SHUTTER_SPEED_HEADING_LEFT, SHUTTER_SPEED_HEADING_TOP, (SHUTTER_SPEED_HEADING_RIGHT-SHUTTER_SPEED_HEADING_LEFT), (SHUTTER_SPEED_HEADING_BOTTOM-SHUTTER_SPEED_HEADING_TOP), BORDER_COLOUR);
+    tft.setTextColor(TEXT_COLOUR);
+    tft.setTextSize(HEADING_TEXT_SIZE);
+    tft.getTextBounds(F("Long Exposure"),0,0,&ulx,&uly,&w,&h);
+    tft.setCursor(SHUTTER_SPEED_HEADING_X - w/2, SHUTTER_SPEED_HEADING_Y);
+    tft.print(F("Long Exposure"));
+    tft.drawRect(0, 0, SCREEN_WIDTH_px, SCREEN_HEIGHT_px, BORDER_COLOUR);
+  }
+
+  // Clear the previous time and status
+  tft.fillRect(1, ELAPSED_Y, SCREEN_WIDTH_px-2, ELAPSED_STATUS_Y+HEADING_TEXT_SIZE*BASE_TEXT_HEIGHT_px-ELAPSED_Y, BACKGROUND_COLOUR);
+
+  tft.setTextColor(TEXT_COLOUR, BACKGROUND_COLOUR);
+  tft.setTextSize(ELAPSED_TEXT_SIZE);
+  if (open)
+  {
+    snprintf_P(buffer, sizeof(buffer), PSTR("%lu.%lus"), (unsigned long)seconds, (unsigned long)(fraction_us / 100000));
+  }
+  else
+  {
+    snprintf_P(buffer, sizeof(buffer), PSTR("%lu.%03lus"), (unsigned long)seconds, (unsigned long)(fraction_us / 1000));
+  }
+  tft.getTextBounds(buffer,0,0,&ulx,&uly,&w,&h);
+  tft.setCursor(SCREEN_WIDTH_px/2 - w/2, ELAPSED_Y);
+  tft.print(buffer);
+
+  tft.setTextSize(HEADING_TEXT_SIZE);
+  const __FlashStringHelper *status = open ? F("Shutter open") : F("Shutter closed");
+  tft.getTextBounds(status,0,0,&ulx,&uly,&w,&h);
+  tft.setCursor(SCREEN_WIDTH_px/2 - w/2, ELAPSED_STATUS_Y);
+  tft.print(status);
+}
+
 void tft_colour_demo()
 {
   const int TEXT_SIZE = 2;
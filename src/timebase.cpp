@@ -0,0 +1,31 @@
+#include "timebase.h"
+
+static uint32_t last_us = 0;
+static uint32_t wraps = 0;
+
+//---------------------------------------------------
+// Called with the current micros(), counts a wrap
+// whenever the time goes backwards
+//---------------------------------------------------
+void timebase_update(uint32_t now_us)
+{
+  if (now_us < last_us)
+  {
+    wraps++;
+  }
+  last_us = now_us;
+}
+
+uint64_t timebase_now_us()
+{
+  return ((uint64_t)wraps << 32) | last_us;
+}
+
+//---------------------------------------------------
+// Turn a micros() timestamp into a 64 bit time by
+// counting from the last update, backwards or forwards
+//---------------------------------------------------
+uint64_t timebase_extend(uint32_t ts_us)
+{
+  return timebase_now_us() + (int32_t)(ts_us - last_us);
+}
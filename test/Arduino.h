@@ -0,0 +1,56 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+// Just enough of the Arduino API for the modules under test to build
+// on the host. PlatformIO puts the test directory on the include path,
+// so this stands in for the real header in the native environment.
+// Serial is a fake that the tests feed and read back.
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include <string>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define vsnprintf_P vsnprintf
+#define memcpy_P memcpy
+#define strcasecmp_P strcasecmp
+
+class FakeSerial
+{
+public:
+  std::string received;    // bytes waiting to be read
+  std::string sent;        // everything written
+  int write_room = 64;     // free space in the transmit buffer on each call
+  size_t bytes_read = 0;
+
+  int available() { return received.size(); }
+
+  int read()
+  {
+    if (received.empty())
+    {
+      return -1;
+    }
+    char c = received[0];
+    received.erase(0, 1);
+    bytes_read++;
+    return c;
+  }
+
+  size_t write(uint8_t c)
+  {
+    sent += (char)c;
+    return 1;
+  }
+
+  int availableForWrite() { return write_room; }
+};
+
+extern FakeSerial Serial;
+
+#endif
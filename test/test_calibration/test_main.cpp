@@ -0,0 +1,122 @@
+#include <unity.h>
+
+#include "calibration.h"
+
+// Simulated receivers, each slower to respond to the light coming on
+// than going off and each different, as the ISO203s are
+static const uint32_t on_delay_us[CALIBRATION_CHANNELS] = {42, 55, 47};
+static const uint32_t off_delay_us[CALIBRATION_CHANNELS] = {12, 20, 9};
+
+//---------------------------------------------------
+// Feed a calibration run the way run_calibration()
+// does, one channel at a time, with +-1us of jitter
+//---------------------------------------------------
+static void run_simulated_calibration(uint32_t reference_us)
+{
+  calibration_begin();
+  for (uint8_t pulse = 0; pulse < 16; pulse++)
+  {
+    for (uint8_t i = 0; i < CALIBRATION_CHANNELS; i++)
+    {
+      int8_t jitter = (pulse % 3) - 1;
+      uint32_t off_ts = reference_us + off_delay_us[i] + jitter;
+      uint32_t on_ts = reference_us + 20000 + on_delay_us[i] - jitter;
+      calibration_add_sample(i, false, off_ts - reference_us);
+      calibration_add_sample(i, true, on_ts - (reference_us + 20000));
+      reference_us += 40000;
+    }
+  }
+}
+
+void setUp()
+{
+  calibration_clear();
+}
+
+void tearDown()
+{
+}
+
+void test_offsets_are_the_mean_delays()
+{
+  run_simulated_calibration(1000);
+  TEST_ASSERT_TRUE(calibration_finish());
+  const calibration_t *cal = calibration_get();
+  for (uint8_t i = 0; i < CALIBRATION_CHANNELS; i++)
+  {
+    TEST_ASSERT_EQUAL_INT16(on_delay_us[i], cal->light_on_us[i]);
+    TEST_ASSERT_EQUAL_INT16(off_delay_us[i], cal->light_off_us[i]);
+  }
+}
+
+void test_calibrated_shot_has_no_error_or_skew()
+{
+  run_simulated_calibration(1000);
+  TEST_ASSERT_TRUE(calibration_finish());
+
+  // a 1/1000s exposure, the curtains take 8000us from S1 to S3
+  uint32_t open_us[CALIBRATION_CHANNELS] = {500000, 504000, 508000};
+  uint32_t start_us[CALIBRATION_CHANNELS];
+  uint32_t end_us[CALIBRATION_CHANNELS];
+  for (uint8_t i = 0; i < CALIBRATION_CHANNELS; i++)
+  {
+    start_us[i] = calibration_start_us(i, open_us[i] + on_delay_us[i]);
+    end_us[i] = calibration_end_us(i, open_us[i] + 1000 + off_delay_us[i]);
+    TEST_ASSERT_EQUAL_UINT32(1000, end_us[i] - start_us[i]);
+  }
+  TEST_ASSERT_EQUAL_INT32(8000, (int32_t)(start_us[2] - start_us[0]));
+  TEST_ASSERT_EQUAL_INT32(8000, (int32_t)(end_us[2] - end_us[0]));
+}
+
+void test_uncalibrated_shot_shows_the_sensor_error()
+{
+  uint32_t start_us = calibration_start_us(1, 500000 + on_delay_us[1]);
+  uint32_t end_us = calibration_end_us(1, 501000 + off_delay_us[1]);
+  TEST_ASSERT_EQUAL_UINT32(1000 - (on_delay_us[1] - off_delay_us[1]), end_us - start_us);
+}
+
+void test_offsets_apply_across_micros_wrap()
+{
+  run_simulated_calibration(0xFFFFFF00UL);
+  TEST_ASSERT_TRUE(calibration_finish());
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFF0UL, calibration_start_us(0, 0xFFFFFFF0UL + on_delay_us[0]));
+  TEST_ASSERT_EQUAL_UINT32(0x00000010UL, calibration_end_us(2, 0x00000010UL + off_delay_us[2]));
+}
+
+void test_missing_channel_fails_and_keeps_old_offsets()
+{
+  run_simulated_calibration(1000);
+  TEST_ASSERT_TRUE(calibration_finish());
+
+  calibration_begin();
+  calibration_add_sample(0, true, 100);
+  calibration_add_sample(0, false, 100);
+  calibration_add_sample(1, true, 100);
+  calibration_add_sample(1, false, 100);
+  calibration_add_sample(2, true, 100); // never saw the light go off
+  TEST_ASSERT_FALSE(calibration_finish());
+  TEST_ASSERT_EQUAL_INT16(on_delay_us[2], calibration_get()->light_on_us[2]);
+}
+
+void test_stale_timestamps_are_ignored()
+{
+  run_simulated_calibration(1000);
+  // a timestamp from before the reference wraps round to a huge delay
+  calibration_add_sample(1, true, (uint32_t)-5);
+  calibration_add_sample(1, false, 0x10000);
+  TEST_ASSERT_TRUE(calibration_finish());
+  TEST_ASSERT_EQUAL_INT16(on_delay_us[1], calibration_get()->light_on_us[1]);
+  TEST_ASSERT_EQUAL_INT16(off_delay_us[1], calibration_get()->light_off_us[1]);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_offsets_are_the_mean_delays);
+  RUN_TEST(test_calibrated_shot_has_no_error_or_skew);
+  RUN_TEST(test_uncalibrated_shot_shows_the_sensor_error);
+  RUN_TEST(test_offsets_apply_across_micros_wrap);
+  RUN_TEST(test_missing_channel_fails_and_keeps_old_offsets);
+  RUN_TEST(test_stale_timestamps_are_ignored);
+  return UNITY_END();
+}
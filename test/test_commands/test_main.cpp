@@ -0,0 +1,187 @@
+#include <unity.h>
+
+#include "Arduino.h"
+
+// commands.cpp needs the real Serial port, which only the fake in
+// Arduino.h provides, so it is built into this test rather than the
+// native environment
+#include "../../src/commands.cpp"
+
+FakeSerial Serial;
+
+static uint8_t multi_calls = 0;
+
+static bool cmd_one(const char *args, uint8_t step)
+{
+  commands_printf_P(PSTR("a=1\r\nOK\r\n"));
+  return false;
+}
+
+static bool cmd_echo(const char *args, uint8_t step)
+{
+  commands_printf_P(PSTR("args=%s\r\nOK\r\n"), args);
+  return false;
+}
+
+static bool cmd_multi(const char *args, uint8_t step)
+{
+  multi_calls++;
+  if (step < 3)
+  {
+    commands_printf_P(PSTR("line=%u\r\n"), step);
+    return true;
+  }
+  commands_printf_P(PSTR("OK\r\n"));
+  return false;
+}
+
+// laid out in PROGMEM as main.cpp does
+static const char name_one[] PROGMEM = "one";
+static const char name_echo[] PROGMEM = "echo";
+static const char name_multi[] PROGMEM = "multi";
+
+static const command_t table[] PROGMEM = {
+    {name_one, cmd_one},
+    {name_echo, cmd_echo},
+    {name_multi, cmd_multi},
+};
+
+//---------------------------------------------------
+// Poll until everything received has been handled
+// and all the output has been sent
+//---------------------------------------------------
+static void run_until_idle()
+{
+  for (int i = 0; i < 200; i++)
+  {
+    commands_poll();
+  }
+}
+
+void setUp()
+{
+  run_until_idle();
+  Serial = FakeSerial();
+  multi_calls = 0;
+  commands_setup(table, sizeof(table) / sizeof(table[0]));
+}
+
+void tearDown()
+{
+}
+
+void test_command_is_answered()
+{
+  Serial.received = "one\n";
+  run_until_idle();
+  TEST_ASSERT_EQUAL_STRING("a=1\r\nOK\r\n", Serial.sent.c_str());
+}
+
+void test_name_is_not_case_sensitive_and_cr_is_ignored()
+{
+  Serial.received = "ONE\r\n";
+  run_until_idle();
+  TEST_ASSERT_EQUAL_STRING("a=1\r\nOK\r\n", Serial.sent.c_str());
+}
+
+void test_arguments_are_split_from_the_name()
+{
+  Serial.received = "  echo   hello world\n";
+  run_until_idle();
+  TEST_ASSERT_EQUAL_STRING("args=hello world\r\nOK\r\n", Serial.sent.c_str());
+}
+
+void test_unknown_command()
+{
+  Serial.received = "bogus\n";
+  run_until_idle();
+  TEST_ASSERT_EQUAL_STRING("ERR unknown command\r\n", Serial.sent.c_str());
+}
+
+void test_empty_line_is_ignored()
+{
+  Serial.received = "\n   \n";
+  run_until_idle();
+  TEST_ASSERT_EQUAL_STRING("", Serial.sent.c_str());
+}
+
+void test_receive_is_bounded_per_poll()
+{
+  Serial.received = "echo 0123456789012345\n";
+  commands_poll();
+  TEST_ASSERT_EQUAL(COMMAND_RX_BYTES_PER_POLL, Serial.bytes_read);
+  commands_poll();
+  TEST_ASSERT_EQUAL(2 * COMMAND_RX_BYTES_PER_POLL, Serial.bytes_read);
+  run_until_idle();
+  TEST_ASSERT_EQUAL_STRING("args=0123456789012345\r\nOK\r\n", Serial.sent.c_str());
+}
+
+void test_long_line_is_rejected_and_next_line_works()
+{
+  Serial.received = std::string(COMMAND_RX_BUFFER_SIZE + 10, 'x') + "\none\n";
+  run_until_idle();
+  TEST_ASSERT_EQUAL_STRING("ERR line too long\r\na=1\r\nOK\r\n", Serial.sent.c_str());
+}
+
+void test_multi_step_handler_runs_one_step_per_poll()
+{
+  Serial.received = "multi\n";
+  commands_poll();
+  TEST_ASSERT_EQUAL(1, multi_calls);
+  commands_poll();
+  TEST_ASSERT_EQUAL(2, multi_calls);
+  run_until_idle();
+  TEST_ASSERT_EQUAL(4, multi_calls);
+  TEST_ASSERT_EQUAL_STRING("line=0\r\nline=1\r\nline=2\r\nOK\r\n", Serial.sent.c_str());
+}
+
+void test_input_waits_while_a_command_is_answering()
+{
+  Serial.received = "multi\none\n";
+  run_until_idle();
+  TEST_ASSERT_EQUAL_STRING("line=0\r\nline=1\r\nline=2\r\nOK\r\na=1\r\nOK\r\n", Serial.sent.c_str());
+}
+
+void test_transmit_only_uses_free_space()
+{
+  Serial.write_room = 3;
+  Serial.received = "one\n";
+  commands_poll(); // reads the line and queues the answer
+  commands_poll(); // sends what fits
+  TEST_ASSERT_EQUAL_STRING("a=1", Serial.sent.c_str());
+  Serial.write_room = 0;
+  commands_poll();
+  TEST_ASSERT_EQUAL_STRING("a=1", Serial.sent.c_str());
+  Serial.write_room = 64;
+  run_until_idle();
+  TEST_ASSERT_EQUAL_STRING("a=1\r\nOK\r\n", Serial.sent.c_str());
+}
+
+void test_line_that_does_not_fit_is_dropped_whole()
+{
+  std::string line(70, 'y');
+  Serial.write_room = 0;
+  commands_printf_P(PSTR("%s\n"), line.c_str());
+  commands_printf_P(PSTR("%s\n"), line.c_str());
+  commands_printf_P(PSTR("%s\n"), line.c_str()); // only 18 bytes left
+  Serial.write_room = 64;
+  run_until_idle();
+  TEST_ASSERT_EQUAL_STRING((line + "\n" + line + "\n").c_str(), Serial.sent.c_str());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_command_is_answered);
+  RUN_TEST(test_name_is_not_case_sensitive_and_cr_is_ignored);
+  RUN_TEST(test_arguments_are_split_from_the_name);
+  RUN_TEST(test_unknown_command);
+  RUN_TEST(test_empty_line_is_ignored);
+  RUN_TEST(test_receive_is_bounded_per_poll);
+  RUN_TEST(test_long_line_is_rejected_and_next_line_works);
+  RUN_TEST(test_multi_step_handler_runs_one_step_per_poll);
+  RUN_TEST(test_input_waits_while_a_command_is_answering);
+  RUN_TEST(test_transmit_only_uses_free_space);
+  RUN_TEST(test_line_that_does_not_fit_is_dropped_whole);
+  return UNITY_END();
+}
@@ -0,0 +1,186 @@
+#include <unity.h>
+
+#include "edge_filter.h"
+
+static edge_channel_t channel;
+
+// the longest the shared interrupt can delay a timestamp
+#define WORST_LATENCY_US 22
+
+void setUp()
+{
+  edge_filter_set_width(EDGE_FILTER_DEFAULT_WIDTH_US);
+  edge_filter_set_hold(EDGE_FILTER_DEFAULT_HOLD_US);
+  edge_filter_reset(&channel, false);
+}
+
+void tearDown()
+{
+}
+
+//---------------------------------------------------
+// A pulse of light, or of dark if light is false
+//---------------------------------------------------
+static void pulse(bool light, uint32_t at_us, uint32_t width_us)
+{
+  edge_filter_edge(&channel, light, at_us);
+  edge_filter_edge(&channel, !light, at_us + width_us);
+}
+
+void test_exposure_is_measured_exactly()
+{
+  pulse(true, 1000, 125);
+  TEST_ASSERT_FALSE(edge_filter_settled(&channel, 1125 + EDGE_FILTER_DEFAULT_WIDTH_US - 1));
+  TEST_ASSERT_TRUE(edge_filter_settled(&channel, 1125 + EDGE_FILTER_DEFAULT_WIDTH_US));
+  TEST_ASSERT_TRUE(channel.speed_measured);
+  TEST_ASSERT_EQUAL_UINT32(1000, channel.start_us);
+  TEST_ASSERT_EQUAL_UINT32(1125, channel.end_us);
+  TEST_ASSERT_EQUAL_UINT16(0, channel.rejected);
+}
+
+void test_glitch_in_the_dark_is_undone()
+{
+  pulse(true, 1000, 3);
+  TEST_ASSERT_FALSE(channel.speed_measured);
+  TEST_ASSERT_FALSE(channel.light);
+  TEST_ASSERT_EQUAL_UINT16(1, channel.rejected);
+}
+
+void test_glitch_during_exposure_is_undone()
+{
+  edge_filter_edge(&channel, true, 1000);
+  pulse(false, 5000, 4);
+  edge_filter_edge(&channel, false, 9000);
+  TEST_ASSERT_TRUE(channel.speed_measured);
+  TEST_ASSERT_EQUAL_UINT32(1000, channel.start_us);
+  TEST_ASSERT_EQUAL_UINT32(9000, channel.end_us);
+}
+
+void test_glitch_stretched_by_interrupt_latency_is_undone()
+{
+  // a 10us glitch whose second edge waited for the other handlers
+  pulse(true, 1000, 10 + WORST_LATENCY_US - 1);
+  TEST_ASSERT_FALSE(channel.speed_measured);
+  TEST_ASSERT_EQUAL_UINT16(1, channel.rejected);
+}
+
+void test_edge_to_the_same_level_is_rejected()
+{
+  // the opposite edge was over before the interrupt read the pin
+  edge_filter_edge(&channel, false, 1000);
+  TEST_ASSERT_EQUAL_UINT16(1, channel.rejected);
+  TEST_ASSERT_FALSE(channel.pending);
+}
+
+void test_zero_width_turns_the_filter_off()
+{
+  edge_filter_set_width(0);
+  pulse(true, 1000, 1);
+  TEST_ASSERT_TRUE(channel.speed_measured);
+  TEST_ASSERT_EQUAL_UINT32(1, channel.end_us - channel.start_us);
+}
+
+void test_exposure_across_micros_wrap()
+{
+  pulse(true, 0xFFFFFF00UL, 0x200);
+  TEST_ASSERT_TRUE(channel.speed_measured);
+  TEST_ASSERT_EQUAL_UINT32(0x200, channel.end_us - channel.start_us);
+  TEST_ASSERT_TRUE(edge_filter_settled(&channel, 0x100 + EDGE_FILTER_DEFAULT_WIDTH_US));
+}
+
+void test_bounce_does_not_replace_the_curtain_exposure()
+{
+  pulse(true, 1000, 2000);
+  pulse(true, 3300, 60); // the curtain bounces open again
+  TEST_ASSERT_TRUE(channel.curtain_measured);
+  TEST_ASSERT_EQUAL_UINT32(1000, channel.curtain_start_us);
+  TEST_ASSERT_EQUAL_UINT32(3000, channel.curtain_end_us);
+  // the shutter time is the latest exposure
+  TEST_ASSERT_EQUAL_UINT32(3300, channel.start_us);
+}
+
+void test_next_shot_replaces_the_curtain_exposure_after_the_hold()
+{
+  pulse(true, 1000, 2000);
+  pulse(true, 3000 + EDGE_FILTER_DEFAULT_HOLD_US, 500);
+  TEST_ASSERT_TRUE(channel.curtain_measured);
+  TEST_ASSERT_EQUAL_UINT32(1000 + 2000 + EDGE_FILTER_DEFAULT_HOLD_US, channel.curtain_start_us);
+}
+
+void test_taken_curtain_exposure_is_replaced_at_once()
+{
+  pulse(true, 1000, 2000);
+  channel.curtain_measured = false; // as take_curtains() does
+  pulse(true, 3300, 60);
+  TEST_ASSERT_TRUE(channel.curtain_measured);
+  TEST_ASSERT_EQUAL_UINT32(3300, channel.curtain_start_us);
+}
+
+//---------------------------------------------------
+// A noisy stream: an exposure with glitches of up to
+// 10us before, during and after it, every edge
+// delayed by up to the worst interrupt latency
+//---------------------------------------------------
+static uint32_t random_state = 12345;
+
+static uint32_t random_below(uint32_t limit)
+{
+  random_state = random_state * 1103515245UL + 12345UL;
+  return (random_state >> 8) % limit;
+}
+
+void test_noisy_streams_measure_the_exposure()
+{
+  for (int run = 0; run < 1000; run++)
+  {
+    edge_filter_reset(&channel, false);
+    uint32_t base_us = random_below(0xFFFFFFFFUL);
+    uint32_t open_us = base_us + 1000;
+    uint32_t close_us = open_us + 500 + random_below(10000);
+
+    uint32_t glitches[3] = {
+        base_us + 100 + random_below(800),
+        open_us + 100 + random_below(close_us - open_us - 200),
+        close_us + 100 + random_below(800)};
+
+    for (int g = 0; g < 3; g++)
+    {
+      bool light = (g == 1) ? false : true;
+      uint32_t width_us = 1 + random_below(10);
+      uint32_t first_us = glitches[g] + random_below(3);
+      uint32_t second_us = first_us + width_us + random_below(WORST_LATENCY_US);
+      if (g == 1)
+      {
+        edge_filter_edge(&channel, true, open_us + random_below(3));
+      }
+      edge_filter_edge(&channel, light, first_us);
+      edge_filter_edge(&channel, !light, second_us);
+      if (g == 1)
+      {
+        edge_filter_edge(&channel, false, close_us + random_below(3));
+      }
+    }
+
+    TEST_ASSERT_TRUE(channel.curtain_measured);
+    TEST_ASSERT_EQUAL_UINT16(3, channel.rejected);
+    TEST_ASSERT_TRUE(channel.curtain_start_us - open_us < 3);
+    TEST_ASSERT_TRUE(channel.curtain_end_us - close_us < 3);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_exposure_is_measured_exactly);
+  RUN_TEST(test_glitch_in_the_dark_is_undone);
+  RUN_TEST(test_glitch_during_exposure_is_undone);
+  RUN_TEST(test_glitch_stretched_by_interrupt_latency_is_undone);
+  RUN_TEST(test_edge_to_the_same_level_is_rejected);
+  RUN_TEST(test_zero_width_turns_the_filter_off);
+  RUN_TEST(test_exposure_across_micros_wrap);
+  RUN_TEST(test_bounce_does_not_replace_the_curtain_exposure);
+  RUN_TEST(test_next_shot_replaces_the_curtain_exposure_after_the_hold);
+  RUN_TEST(test_taken_curtain_exposure_is_replaced_at_once);
+  RUN_TEST(test_noisy_streams_measure_the_exposure);
+  return UNITY_END();
+}
@@ -0,0 +1,109 @@
+#include <unity.h>
+
+#include "calibration.h"
+#include "measure.h"
+
+static edge_channel_t channels[3];
+
+void setUp()
+{
+  calibration_clear();
+  edge_filter_set_width(EDGE_FILTER_DEFAULT_WIDTH_US);
+  edge_filter_set_hold(EDGE_FILTER_DEFAULT_HOLD_US);
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    edge_filter_reset(&channels[i], false);
+  }
+}
+
+void tearDown()
+{
+}
+
+//---------------------------------------------------
+// An exposure on one detector
+//---------------------------------------------------
+static void expose(uint8_t detector, uint32_t open_us, uint32_t close_us)
+{
+  edge_filter_edge(&channels[detector], true, open_us);
+  edge_filter_edge(&channels[detector], false, close_us);
+}
+
+void test_speed_waits_for_the_last_edge_to_settle()
+{
+  uint32_t start_us;
+  uint32_t end_us;
+  expose(1, 1000, 9000);
+  TEST_ASSERT_FALSE(measure_take_speed(channels, 1, 9000 + EDGE_FILTER_DEFAULT_WIDTH_US - 1, &start_us, &end_us));
+  TEST_ASSERT_TRUE(measure_take_speed(channels, 1, 9000 + EDGE_FILTER_DEFAULT_WIDTH_US, &start_us, &end_us));
+  TEST_ASSERT_EQUAL_UINT32(1000, start_us);
+  TEST_ASSERT_EQUAL_UINT32(9000, end_us);
+}
+
+void test_speed_is_taken_once()
+{
+  uint32_t start_us;
+  uint32_t end_us;
+  expose(1, 1000, 9000);
+  TEST_ASSERT_TRUE(measure_take_speed(channels, 1, 20000, &start_us, &end_us));
+  TEST_ASSERT_FALSE(measure_take_speed(channels, 1, 20000, &start_us, &end_us));
+}
+
+void test_curtains_need_both_outer_detectors()
+{
+  uint32_t curtain_1_us;
+  uint32_t curtain_2_us;
+  expose(0, 1000, 2000);
+  TEST_ASSERT_FALSE(measure_take_curtains(channels, 20000, &curtain_1_us, &curtain_2_us));
+  expose(2, 9000, 10500);
+  TEST_ASSERT_TRUE(measure_take_curtains(channels, 20000, &curtain_1_us, &curtain_2_us));
+  TEST_ASSERT_EQUAL_UINT32(8000, curtain_1_us);
+  TEST_ASSERT_EQUAL_UINT32(8500, curtain_2_us);
+  TEST_ASSERT_FALSE(measure_take_curtains(channels, 20000, &curtain_1_us, &curtain_2_us));
+}
+
+void test_travel_direction_does_not_matter()
+{
+  TEST_ASSERT_EQUAL_UINT32(8000, measure_travel_us(1000, 9000));
+  TEST_ASSERT_EQUAL_UINT32(8000, measure_travel_us(9000, 1000));
+}
+
+void test_curtains_use_the_first_exposure_not_the_bounce()
+{
+  uint32_t curtain_1_us;
+  uint32_t curtain_2_us;
+  expose(0, 1000, 2000);
+  expose(0, 2500, 2600); // bounce
+  expose(2, 9000, 10000);
+  TEST_ASSERT_TRUE(measure_take_curtains(channels, 20000, &curtain_1_us, &curtain_2_us));
+  TEST_ASSERT_EQUAL_UINT32(8000, curtain_1_us);
+  TEST_ASSERT_EQUAL_UINT32(8000, curtain_2_us);
+}
+
+void test_calibration_is_applied()
+{
+  uint32_t start_us;
+  uint32_t end_us;
+  calibration_begin();
+  for (uint8_t i = 0; i < CALIBRATION_CHANNELS; i++)
+  {
+    calibration_add_sample(i, true, 40 + i);
+    calibration_add_sample(i, false, 10);
+  }
+  TEST_ASSERT_TRUE(calibration_finish());
+  expose(1, 1041, 9010);
+  TEST_ASSERT_TRUE(measure_take_speed(channels, 1, 20000, &start_us, &end_us));
+  TEST_ASSERT_EQUAL_UINT32(8000, end_us - start_us);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_speed_waits_for_the_last_edge_to_settle);
+  RUN_TEST(test_speed_is_taken_once);
+  RUN_TEST(test_curtains_need_both_outer_detectors);
+  RUN_TEST(test_travel_direction_does_not_matter);
+  RUN_TEST(test_curtains_use_the_first_exposure_not_the_bounce);
+  RUN_TEST(test_calibration_is_applied);
+  return UNITY_END();
+}
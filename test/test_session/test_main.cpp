@@ -0,0 +1,116 @@
+#include <unity.h>
+
+#include "session.h"
+
+void setUp()
+{
+  session_begin();
+}
+
+void tearDown()
+{
+}
+
+void test_shot_goes_to_the_nearest_speed()
+{
+  session_row_t row;
+  TEST_ASSERT_EQUAL_INT8(-1, session_add_speed(8100));
+  TEST_ASSERT_TRUE(session_row(0, &row));
+  TEST_ASSERT_EQUAL_UINT16(125, row.denominator);
+  TEST_ASSERT_EQUAL_UINT32(8100, row.mean_us);
+}
+
+void test_boundary_is_half_way_in_stops()
+{
+  // 1/8 to 1/15 and 1/60 to 1/125 are not whole stops, the boundary
+  // is the geometric mean of the two nominal times
+  session_row_t row;
+  session_add_speed(90000); // 0.43 stops from 1/15, 0.47 from 1/8
+  TEST_ASSERT_TRUE(session_row(0, &row));
+  TEST_ASSERT_EQUAL_UINT16(15, row.denominator);
+
+  session_begin();
+  session_add_speed(11700); // 0.51 stops from 1/60, 0.55 from 1/125
+  TEST_ASSERT_TRUE(session_row(0, &row));
+  TEST_ASSERT_EQUAL_UINT16(60, row.denominator);
+
+  session_begin();
+  session_add_speed(47140);
+  session_add_speed(47139);
+  TEST_ASSERT_TRUE(session_row(0, &row));
+  TEST_ASSERT_EQUAL_UINT16(15, row.denominator);
+  TEST_ASSERT_TRUE(session_row(1, &row));
+  TEST_ASSERT_EQUAL_UINT16(30, row.denominator);
+}
+
+void test_error_is_capped_at_half_a_stop_without_a_declaration()
+{
+  // a 1/250 shutter a whole stop slow looks like a perfect 1/125
+  session_row_t row;
+  session_add_speed(8000);
+  TEST_ASSERT_TRUE(session_row(0, &row));
+  TEST_ASSERT_EQUAL_UINT16(125, row.denominator);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 0.0, row.ev_error);
+}
+
+void test_declared_speed_shows_the_whole_error()
+{
+  session_row_t row;
+  TEST_ASSERT_TRUE(session_declare(250));
+  TEST_ASSERT_EQUAL_UINT16(250, session_declared());
+  session_add_speed(8000);
+  session_add_speed(16000);
+  TEST_ASSERT_EQUAL_UINT8(1, session_row_count());
+  TEST_ASSERT_TRUE(session_row(0, &row));
+  TEST_ASSERT_EQUAL_UINT16(250, row.denominator);
+  TEST_ASSERT_EQUAL_UINT8(2, row.count);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 1.585, row.ev_error); // 12000us is log2(3) stops over
+}
+
+void test_new_declaration_closes_the_group()
+{
+  session_declare(250);
+  session_add_speed(4000);
+  session_declare(500);
+  TEST_ASSERT_EQUAL_INT8(8, session_add_speed(2000)); // 1/250 is setting 8
+  TEST_ASSERT_EQUAL_UINT8(2, session_row_count());
+}
+
+void test_auto_goes_back_to_the_nearest_speed()
+{
+  session_row_t row;
+  session_declare(250);
+  TEST_ASSERT_TRUE(session_declare(0));
+  TEST_ASSERT_EQUAL_UINT16(0, session_declared());
+  session_add_speed(8000);
+  TEST_ASSERT_TRUE(session_row(0, &row));
+  TEST_ASSERT_EQUAL_UINT16(125, row.denominator);
+}
+
+void test_only_standard_speeds_can_be_declared()
+{
+  session_declare(60);
+  TEST_ASSERT_FALSE(session_declare(100));
+  TEST_ASSERT_EQUAL_UINT16(60, session_declared());
+}
+
+void test_new_session_forgets_the_declaration()
+{
+  session_declare(60);
+  session_begin();
+  TEST_ASSERT_EQUAL_UINT16(0, session_declared());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_shot_goes_to_the_nearest_speed);
+  RUN_TEST(test_boundary_is_half_way_in_stops);
+  RUN_TEST(test_error_is_capped_at_half_a_stop_without_a_declaration);
+  RUN_TEST(test_declared_speed_shows_the_whole_error);
+  RUN_TEST(test_new_declaration_closes_the_group);
+  RUN_TEST(test_auto_goes_back_to_the_nearest_speed);
+  RUN_TEST(test_only_standard_speeds_can_be_declared);
+  RUN_TEST(test_new_session_forgets_the_declaration);
+  return UNITY_END();
+}
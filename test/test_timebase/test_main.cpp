@@ -0,0 +1,94 @@
+#include <unity.h>
+
+#include "measure.h"
+#include "timebase.h"
+
+// The timebase keeps its count between tests, so each one works
+// relative to where the last one left it
+static uint64_t base_us;
+
+void setUp()
+{
+  timebase_update(0);
+  timebase_update(0xFFFFFFFFUL);
+  timebase_update(0);
+  base_us = timebase_now_us();
+}
+
+void tearDown()
+{
+}
+
+void test_wrap_is_counted()
+{
+  timebase_update(0xFFFFFFF0UL);
+  TEST_ASSERT_EQUAL_UINT64(base_us + 0xFFFFFFF0ULL, timebase_now_us());
+  timebase_update(0x10);
+  TEST_ASSERT_EQUAL_UINT64(base_us + 0x100000010ULL, timebase_now_us());
+}
+
+void test_time_without_a_wrap_is_not_counted()
+{
+  timebase_update(0x10);
+  timebase_update(0x10);
+  timebase_update(0x20);
+  TEST_ASSERT_EQUAL_UINT64(base_us + 0x20, timebase_now_us());
+}
+
+void test_timestamp_before_the_wrap_is_extended_back()
+{
+  timebase_update(0xFFFFFFF0UL);
+  timebase_update(0x10);
+  TEST_ASSERT_EQUAL_UINT64(base_us + 0xFFFFFFF8ULL, timebase_extend(0xFFFFFFF8UL));
+}
+
+void test_timestamp_after_the_update_is_extended_forward()
+{
+  // a calibrated end time can be a little after the snapshot it was
+  // taken with; it must not be mistaken for one nearly a wrap old
+  timebase_update(0xFFFFFFF0UL);
+  timebase_update(0x10);
+  TEST_ASSERT_EQUAL_UINT64(base_us + 0x100000020ULL, timebase_extend(0x20));
+}
+
+void test_timestamp_a_little_after_the_update_before_the_wrap()
+{
+  timebase_update(0xFFFFFFFEUL);
+  TEST_ASSERT_EQUAL_UINT64(base_us + 0x100000002ULL, timebase_extend(0x2));
+}
+
+void test_long_exposure_across_the_wrap()
+{
+  // the main loop snapshots micros() and updates in one critical
+  // section, then extends the edges it took with that snapshot
+  timebase_update(0xF0000000UL);
+  uint64_t start_us = timebase_extend(0xEFFFF000UL);
+  for (uint32_t now_us = 0xF0000000UL; now_us < 0xFFF00000UL; now_us += 0x00100000UL)
+  {
+    timebase_update(now_us);
+  }
+  timebase_update(0x00500000UL);
+  timebase_update(0x30000000UL);
+  uint64_t end_us = timebase_extend(0x2FFFF000UL);
+  TEST_ASSERT_EQUAL_UINT64(0x40000000ULL, end_us - start_us);
+}
+
+void test_curtain_delta_across_the_micros_wrap()
+{
+  // S1 just before micros() wraps, S3 8000us later just after it
+  TEST_ASSERT_EQUAL_UINT32(8000, measure_travel_us(0xFFFFF000UL, 0x00000F40UL));
+  TEST_ASSERT_EQUAL_UINT32(8000, measure_travel_us(0x00000F40UL, 0xFFFFF000UL));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_wrap_is_counted);
+  RUN_TEST(test_time_without_a_wrap_is_not_counted);
+  RUN_TEST(test_timestamp_before_the_wrap_is_extended_back);
+  RUN_TEST(test_timestamp_after_the_update_is_extended_forward);
+  RUN_TEST(test_timestamp_a_little_after_the_update_before_the_wrap);
+  RUN_TEST(test_long_exposure_across_the_wrap);
+  RUN_TEST(test_curtain_delta_across_the_micros_wrap);
+  return UNITY_END();
+}
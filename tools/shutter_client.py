@@ -0,0 +1,159 @@
+"""Host side client for the shutter speed tester serial command interface.
+
+Typical use from a test rig:
+
+    from shutter_client import ShutterTester
+
+    tester = ShutterTester.open("/dev/ttyUSB0")
+    tester.reset()
+    tester.arm()
+    ...  # fire the shutter
+    print(tester.stats())
+
+The tester answers every command with zero or more lines of
+"key=value" pairs followed by "OK" or "ERR <reason>", see
+src/commands.cpp. Lines starting with "!" report events, such as a
+group of shots being closed during a session, and are collected in
+ShutterTester.events. Any object with write(bytes) and readline() -> bytes
+can be used as the stream, which allows driving the client from a
+simulated serial port.
+"""
+
+BAUD_RATE = 115200
+
+
+class CommandError(Exception):
+    """The tester answered a command with ERR."""
+
+
+class ShutterTester:
+    def __init__(self, stream):
+        self.stream = stream
+        self.events = []
+
+    @classmethod
+    def open(cls, port, timeout=2.0):
+        import serial  # pyserial
+
+        return cls(serial.Serial(port, BAUD_RATE, timeout=timeout))
+
+    def command(self, line):
+        """Send a command and return the lines of its response."""
+        self.stream.write((line + "\n").encode("ascii"))
+        lines = []
+        while True:
+            raw = self.stream.readline()
+            if not raw:
+                raise TimeoutError("no response to %r" % line)
+            text = raw.decode("ascii", "replace").strip()
+            if text == "OK":
+                return lines
+            if text.startswith("ERR"):
+                raise CommandError(text[3:].strip())
+            if text.startswith("!"):
+                self.events.append(text[1:])
+                continue
+            if text:
+                lines.append(text)
+
+    def records(self, line):
+        """Send a command and parse each response line into
+        (name, {key: value}) where the name is the first word if it
+        is not itself a key=value pair."""
+        result = []
+        for text in self.command(line):
+            words = text.split()
+            name = None
+            if words and "=" not in words[0]:
+                name = words.pop(0)
+            fields = {}
+            for word in words:
+                key, _, value = word.partition("=")
+                try:
+                    fields[key] = int(value)
+                except ValueError:
+                    fields[key] = value
+            result.append((name, fields))
+        return result
+
+    def version(self):
+        return self.records("version")[0][1]["version"]
+
+    def arm(self):
+        self.command("arm")
+
+    def disarm(self):
+        self.command("disarm")
+
+    def mode(self, name=None):
+        """Select a mode, or return the current one if name is None."""
+        line = "mode" if name is None else "mode " + name
+        return self.records(line)[0][1]["mode"]
+
+    def stats(self):
+        """Return {"speed1": {...}, ..., "curtain2": {...}}"""
+        return dict(self.records("stats"))
+
+    def log(self):
+        """Return the logged measurements, oldest first."""
+        return self.records("log")
+
+    def calibration(self):
+        """Return ({"channel1": {"on_us": .., "off_us": ..}, ...}, status)"""
+        records = self.records("cal")
+        status = records.pop()[1]["status"]
+        return dict(records), status
+
+    def calibrate(self, timeout=5.0):
+        """Run a calibration and return the new offsets. The tester
+        goes back to normal mode by itself when it has finished."""
+        import time
+
+        self.mode("calibrate")
+        deadline = time.monotonic() + timeout
+        while self.mode() == "calibrate":
+            if time.monotonic() > deadline:
+                raise TimeoutError("calibration did not finish")
+            time.sleep(0.1)
+        offsets, status = self.calibration()
+        if status != "ok":
+            raise CommandError("calibration " + status)
+        return offsets
+
+    def clear_calibration(self):
+        self.command("cal clear")
+
+    def begin_session(self):
+        """Start a dial sweep, shots are grouped by nominal speed."""
+        self.mode("session")
+
+    def declare(self, denominator):
+        """Declare the speed set on the dial, 1/denominator seconds, so
+        the following shots are grouped under it whatever they measure.
+        0 goes back to grouping each shot by the nearest speed."""
+        reply = self.records("session %s" % (denominator or "auto"))
+        return reply[0][1]["declared"]
+
+    def session(self, end=False):
+        """Return the session summary, one (nominal, {...}) per speed
+        setting, slowest first. With end=True the session is finished
+        and the summary table is shown on the tester's display."""
+        return self.records("session end" if end else "session")
+
+    def long_exposure(self):
+        """Return (open, seconds) for the exposure in progress, or the
+        last one, in long exposure mode."""
+        fields = self.records("long")[0][1]
+        return bool(fields["open"]), fields["s"] + fields["fraction_us"] / 1e6
+
+    def memory(self):
+        """Return the RAM use, including the peak stack use, in bytes."""
+        return self.records("mem")[0][1]
+
+    def performance(self):
+        """Return the last and slowest display update and the slowest
+        pass through the main loop, in microseconds."""
+        return self.records("perf")[0][1]
+
+    def reset(self):
+        self.command("reset")
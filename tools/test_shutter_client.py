@@ -0,0 +1,130 @@
+"""Loopback tests for shutter_client.py against a simulated serial port.
+
+Run from the tools directory with:
+
+    python -m unittest test_shutter_client
+"""
+
+import unittest
+
+from shutter_client import CommandError, ShutterTester
+
+
+class FakeSerial:
+    """Answers each command line with canned response lines, the way
+    the tester does, and records what was written."""
+
+    def __init__(self, replies):
+        self.replies = replies
+        self.written = []
+        self.pending = []
+
+    def write(self, data):
+        self.written.append(data)
+        line = data.decode("ascii").rstrip("\n")
+        self.pending.extend(self.replies.get(line, []))
+
+    def readline(self):
+        if not self.pending:
+            return b""  # a timeout, like pyserial
+        return (self.pending.pop(0) + "\r\n").encode("ascii")
+
+
+def tester(replies):
+    stream = FakeSerial(replies)
+    return ShutterTester(stream), stream
+
+
+class CommandTest(unittest.TestCase):
+    def test_sends_one_line(self):
+        client, stream = tester({"arm": ["armed=1", "OK"]})
+        client.arm()
+        self.assertEqual(stream.written, [b"arm\n"])
+
+    def test_returns_lines_before_ok(self):
+        client, _ = tester({"x": ["a=1", "", "b=2", "OK"]})
+        self.assertEqual(client.command("x"), ["a=1", "b=2"])
+
+    def test_err_raises_with_reason(self):
+        client, _ = tester({"mode bogus": ["ERR unknown mode"]})
+        with self.assertRaises(CommandError) as raised:
+            client.mode("bogus")
+        self.assertEqual(str(raised.exception), "unknown mode")
+
+    def test_no_reply_times_out(self):
+        client, _ = tester({})
+        with self.assertRaises(TimeoutError):
+            client.command("version")
+
+    def test_events_are_collected_not_returned(self):
+        client, _ = tester({"stats": ["!1/125 n=3 mean_us=8000", "speed1 n=0", "OK"]})
+        self.assertEqual(client.command("stats"), ["speed1 n=0"])
+        self.assertEqual(client.events, ["1/125 n=3 mean_us=8000"])
+
+
+class RecordsTest(unittest.TestCase):
+    def test_named_and_unnamed_records(self):
+        client, _ = tester({"q": ["speed1 n=2 min_us=10", "status=ok", "OK"]})
+        self.assertEqual(client.records("q"),
+                         [("speed1", {"n": 2, "min_us": 10}), (None, {"status": "ok"})])
+
+    def test_negative_numbers_are_ints(self):
+        client, _ = tester({"q": ["channel1 on_us=-3 off_us=12", "OK"]})
+        self.assertEqual(client.records("q")[0][1], {"on_us": -3, "off_us": 12})
+
+    def test_non_numbers_stay_strings(self):
+        client, _ = tester({"q": ["1/125 ev=+0.12 mode=session", "OK"]})
+        self.assertEqual(client.records("q")[0], ("1/125", {"ev": "+0.12", "mode": "session"}))
+
+
+class ReplyTest(unittest.TestCase):
+    def test_version(self):
+        client, _ = tester({"version": ["version=1.0.0", "OK"]})
+        self.assertEqual(client.version(), "1.0.0")
+
+    def test_stats(self):
+        client, _ = tester({"stats": [
+            "speed1 n=1 min_us=1000 max_us=1000 mean_us=1000",
+            "speed2 n=0 min_us=0 max_us=0 mean_us=0",
+            "speed3 n=0 min_us=0 max_us=0 mean_us=0",
+            "curtain1 n=0 min_us=0 max_us=0 mean_us=0",
+            "curtain2 n=0 min_us=0 max_us=0 mean_us=0",
+            "OK"]})
+        stats = client.stats()
+        self.assertEqual(sorted(stats), ["curtain1", "curtain2", "speed1", "speed2", "speed3"])
+        self.assertEqual(stats["speed1"]["mean_us"], 1000)
+
+    def test_calibration(self):
+        client, _ = tester({"cal": [
+            "channel1 on_us=30 off_us=-2",
+            "channel2 on_us=35 off_us=1",
+            "channel3 on_us=28 off_us=0",
+            "status=ok",
+            "OK"]})
+        offsets, status = client.calibration()
+        self.assertEqual(status, "ok")
+        self.assertEqual(offsets["channel1"], {"on_us": 30, "off_us": -2})
+
+    def test_long_exposure(self):
+        client, _ = tester({"long": ["open=0 s=125 fraction_us=500000", "OK"]})
+        self.assertEqual(client.long_exposure(), (False, 125.5))
+
+    def test_session_end(self):
+        client, stream = tester({"session end": [
+            "1/125 n=3 mean_us=8010 ev=+0.00 spread_us=40 c1_us=9000 c2_us=9100",
+            "OK"]})
+        rows = client.session(end=True)
+        self.assertEqual(stream.written, [b"session end\n"])
+        self.assertEqual(rows[0][0], "1/125")
+        self.assertEqual(rows[0][1]["n"], 3)
+
+    def test_declare(self):
+        client, stream = tester({"session 125": ["declared=125", "OK"],
+                                 "session auto": ["declared=0", "OK"]})
+        self.assertEqual(client.declare(125), 125)
+        self.assertEqual(client.declare(0), 0)
+        self.assertEqual(stream.written, [b"session 125\n", b"session auto\n"])
+
+
+if __name__ == "__main__":
+    unittest.main()